@@ -1,4 +1,9 @@
 #include "bpred.h"
+#include <string.h>
+#include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define TAKEN   true
 #define NOTTAKEN false
@@ -8,6 +13,12 @@
 #define WEAKLY_TAKEN 0b10
 #define WEAKLY_NOTTAKEN 0b01
 #define STRONGLY_NOTTAKEN 0b00
+#define TAGE_CTR_MAX 3
+#define TAGE_CTR_MIN -4
+#define TAGE_U_MAX 3
+
+// Geometric history lengths of the TAGE tagged tables
+static const uint32_t tage_hist_len[TAGE_NUM_TABLES] = {5, 15, 44, 130};
 
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
@@ -18,6 +29,38 @@ BPRED::BPRED(uint32_t policy) {
     this->pht = std::map<uint16_t, uint8_t>();
     this->stat_num_branches = 0;
     this->stat_num_mispred = 0;
+
+    // Perceptron starts with zero weights and an all-taken history
+    memset(this->perc_weights, 0, sizeof(this->perc_weights));
+    memset(this->perc_bias, 0, sizeof(this->perc_bias));
+    memset(this->perc_hist, 0, sizeof(this->perc_hist));
+    this->perc_row = 0;
+    this->perc_out = 0;
+
+    // TAGE base table starts weakly taken, tagged tables empty
+    memset(this->tage_base, WEAKLY_TAKEN, sizeof(this->tage_base));
+    memset(this->tage_table, 0, sizeof(this->tage_table));
+    memset(this->tage_hist, 0, sizeof(this->tage_hist));
+    this->tage_hist_ptr = 0;
+    for(int ii = 0; ii < TAGE_NUM_TABLES; ii++){
+        Folded_History *fh[3] = {&tage_fold_idx[ii], &tage_fold_tag[0][ii], &tage_fold_tag[1][ii]};
+        uint32_t width[3] = {TAGE_LOG_ENTRIES, TAGE_TAG_BITS, TAGE_TAG_BITS - 1};
+        for(int jj = 0; jj < 3; jj++){
+            fh[jj]->comp = 0;
+            fh[jj]->clength = width[jj];
+            fh[jj]->olength = tage_hist_len[ii];
+            fh[jj]->outpoint = tage_hist_len[ii] % width[jj];
+        }
+    }
+    this->tage_provider = -1;
+    this->tage_alt = -1;
+    this->tage_provider_pred = TAKEN;
+    this->tage_alt_pred = TAKEN;
+    this->tage_provider_new = false;
+    this->tage_use_alt = 0;
+    this->tage_base_idx = 0;
+    this->tage_tick = 0;
+    this->tage_seed = 0x2545F491;
 }
 
 /////////////////////////////////////////////////////////////
@@ -26,15 +69,22 @@ BPRED::BPRED(uint32_t policy) {
 bool BPRED::GetPrediction(uint32_t PC){
     ++stat_num_branches;
     switch(policy){
-        case BPRED_ALWAYS_TAKEN:
-            return TAKEN;
         case BPRED_GSHARE:
+        {
             // Retrieve the two bits to decide taken or not
             uint8_t predict = GetPHTEntry(PCxorGHR(PC));
             if(WEAKLY_TAKEN & predict)
                 return TAKEN;
             else
                 return NOTTAKEN;
+        }
+        case BPRED_PERCEPTRON:
+            return PerceptronPredict(PC);
+        case BPRED_TAGE:
+            return TagePredict(PC);
+        case BPRED_ALWAYS_TAKEN:
+        default:
+            return TAKEN;
     }
 }
 
@@ -47,6 +97,16 @@ void  BPRED::UpdatePredictor(uint32_t PC, bool resolveDir, bool predDir) {
     if(policy == BPRED_ALWAYS_TAKEN)
         return;
 
+    if(policy == BPRED_PERCEPTRON){
+        PerceptronUpdate(resolveDir);
+        return;
+    }
+
+    if(policy == BPRED_TAGE){
+        TageUpdate(resolveDir, predDir);
+        return;
+    }
+
     // XOR ghr with PC to index pht
     uint16_t hsh = PCxorGHR(PC);
     // Update the PHT entry with the newly resovled branch direction
@@ -101,3 +161,222 @@ void BPRED::UpdatePHTEntry(uint16_t hsh, bool resolveDir)
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 
+/////////////////////////////////////////////////////////////
+// Perceptron
+/////////////////////////////////////////////////////////////
+
+// Dot product of one weight row with the history masks. A mask of -1
+// (not taken) negates the weight through (w ^ m) - m, so no multiply
+// is needed and the sum of 16 lanes is done per SSE2 step.
+static inline int32_t PerceptronDot(const int8_t *w, const int8_t *h)
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc = zero;
+    for(int ii = 0; ii < PERC_HIST_LEN; ii += 16){
+        __m128i wv = _mm_loadu_si128((const __m128i *)(w + ii));
+        __m128i hv = _mm_loadu_si128((const __m128i *)(h + ii));
+        wv = _mm_sub_epi8(_mm_xor_si128(wv, hv), hv);
+        // Sign extend to 16 bits, then pairwise add into 32-bit lanes
+        __m128i sign = _mm_cmpgt_epi8(zero, wv);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(wv, sign), ones));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(wv, sign), ones));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+#else
+    int32_t sum = 0;
+    for(int ii = 0; ii < PERC_HIST_LEN; ii++)
+        sum += h[ii] ? -w[ii] : w[ii];
+    return sum;
+#endif
+}
+
+// Move every weight of the row one step towards agreeing with the
+// resolved direction, saturating at +/-PERC_WEIGHT_MAX
+static inline void PerceptronTrain(int8_t *w, const int8_t *h, bool resolveDir)
+{
+#ifdef __SSE2__
+    const __m128i dir = _mm_set1_epi8(resolveDir ? 1 : -1);
+    const __m128i floor = _mm_set1_epi8(-128);
+    for(int ii = 0; ii < PERC_HIST_LEN; ii += 16){
+        __m128i wv = _mm_loadu_si128((const __m128i *)(w + ii));
+        __m128i hv = _mm_loadu_si128((const __m128i *)(h + ii));
+        __m128i delta = _mm_sub_epi8(_mm_xor_si128(dir, hv), hv);
+        wv = _mm_adds_epi8(wv, delta);
+        // Lift -128 back to -127 (subtracting the -1 compare mask adds one)
+        wv = _mm_sub_epi8(wv, _mm_cmpeq_epi8(wv, floor));
+        _mm_storeu_si128((__m128i *)(w + ii), wv);
+    }
+#else
+    for(int ii = 0; ii < PERC_HIST_LEN; ii++){
+        bool agree = (h[ii] == 0) == resolveDir;
+        if(agree && w[ii] < PERC_WEIGHT_MAX)
+            w[ii]++;
+        else if(!agree && w[ii] > -PERC_WEIGHT_MAX)
+            w[ii]--;
+    }
+#endif
+}
+
+bool BPRED::PerceptronPredict(uint32_t PC)
+{
+    perc_row = (PC ^ (PC >> 10)) & (PERC_NUM_ROWS - 1);
+    perc_out = perc_bias[perc_row] + PerceptronDot(perc_weights[perc_row], perc_hist);
+    return perc_out >= 0;
+}
+
+void BPRED::PerceptronUpdate(bool resolveDir)
+{
+    // Train only on a misprediction or when the output was not confident
+    if((perc_out >= 0) != resolveDir || abs(perc_out) <= PERC_THRESHOLD){
+        int8_t *bias = &perc_bias[perc_row];
+        if(resolveDir && *bias < PERC_WEIGHT_MAX)
+            (*bias)++;
+        else if(!resolveDir && *bias > -PERC_WEIGHT_MAX)
+            (*bias)--;
+        PerceptronTrain(perc_weights[perc_row], perc_hist, resolveDir);
+    }
+
+    // Shift the resolved direction into the history masks
+    memmove(perc_hist + 1, perc_hist, PERC_HIST_LEN - 1);
+    perc_hist[0] = resolveDir ? 0 : -1;
+}
+
+/////////////////////////////////////////////////////////////
+// TAGE
+/////////////////////////////////////////////////////////////
+
+static inline void FoldedUpdate(Folded_History *fh, const uint8_t *hist, uint32_t ptr)
+{
+    fh->comp = (fh->comp << 1) ^ hist[ptr & (TAGE_HIST_BUF - 1)];
+    fh->comp ^= hist[(ptr + fh->olength) & (TAGE_HIST_BUF - 1)] << fh->outpoint;
+    fh->comp ^= fh->comp >> fh->clength;
+    fh->comp &= (1 << fh->clength) - 1;
+}
+
+bool BPRED::TagePredict(uint32_t PC)
+{
+    tage_base_idx = PC & ((1 << TAGE_LOG_BASE) - 1);
+    tage_provider = -1;
+    tage_alt = -1;
+
+    // Longest matching history provides, the next longest is the alternate
+    for(int ii = TAGE_NUM_TABLES - 1; ii >= 0; ii--){
+        tage_idx[ii] = (PC ^ (PC >> (TAGE_LOG_ENTRIES - ii)) ^ tage_fold_idx[ii].comp)
+                       & ((1 << TAGE_LOG_ENTRIES) - 1);
+        tage_tag[ii] = (PC ^ tage_fold_tag[0][ii].comp ^ (tage_fold_tag[1][ii].comp << 1))
+                       & ((1 << TAGE_TAG_BITS) - 1);
+        if(!tage_tag[ii])
+            tage_tag[ii] = 1;       // Tag 0 is an empty entry, never a match
+        if(tage_table[ii][tage_idx[ii]].tag == tage_tag[ii]){
+            if(tage_provider < 0)
+                tage_provider = ii;
+            else if(tage_alt < 0)
+                tage_alt = ii;
+        }
+    }
+
+    if(tage_alt >= 0)
+        tage_alt_pred = tage_table[tage_alt][tage_idx[tage_alt]].ctr >= 0;
+    else
+        tage_alt_pred = (tage_base[tage_base_idx] & WEAKLY_TAKEN) != 0;
+
+    tage_provider_new = false;
+    if(tage_provider >= 0){
+        const Tage_Entry *entry = &tage_table[tage_provider][tage_idx[tage_provider]];
+        tage_provider_pred = entry->ctr >= 0;
+        tage_provider_new = (entry->ctr == 0 || entry->ctr == -1) && entry->u == 0;
+    }
+    else
+        tage_provider_pred = tage_alt_pred;
+
+    // A freshly allocated entry is often wrong, trust the alternate while that pays
+    if(tage_provider_new && tage_use_alt >= 0)
+        return tage_alt_pred;
+    return tage_provider_pred;
+}
+
+void BPRED::TageUpdate(bool resolveDir, bool predDir)
+{
+    if(tage_provider_new && tage_provider_pred != tage_alt_pred){
+        if(tage_alt_pred == resolveDir && tage_use_alt < TAGE_USE_ALT_MAX)
+            tage_use_alt++;
+        else if(tage_alt_pred != resolveDir && tage_use_alt > -TAGE_USE_ALT_MAX - 1)
+            tage_use_alt--;
+    }
+
+    if(tage_provider >= 0){
+        Tage_Entry *entry = &tage_table[tage_provider][tage_idx[tage_provider]];
+        // The provider is useful when it disagreed with the alternate and was right
+        if(tage_provider_pred != tage_alt_pred){
+            if(tage_provider_pred == resolveDir)
+                entry->u = SatIncrement(entry->u, TAGE_U_MAX);
+            else
+                entry->u = SatDecrement(entry->u);
+        }
+        if(resolveDir && entry->ctr < TAGE_CTR_MAX)
+            entry->ctr++;
+        else if(!resolveDir && entry->ctr > TAGE_CTR_MIN)
+            entry->ctr--;
+    }
+    else {
+        uint8_t *entry = &tage_base[tage_base_idx];
+        if(resolveDir)
+            *entry = SatIncrement(*entry, STRONGLY_TAKEN);
+        else
+            *entry = SatDecrement(*entry);
+    }
+
+    // On a misprediction, allocate in one longer-history table
+    if(predDir != resolveDir && tage_provider < TAGE_NUM_TABLES - 1){
+        int32_t start = tage_provider + 1;
+        // Randomly skip the first candidate so allocations spread out
+        tage_seed ^= tage_seed << 13;
+        tage_seed ^= tage_seed >> 17;
+        tage_seed ^= tage_seed << 5;
+        if(start < TAGE_NUM_TABLES - 1 && (tage_seed & 1))
+            start++;
+
+        int32_t alloc = -1;
+        for(int ii = start; ii < TAGE_NUM_TABLES; ii++){
+            if(tage_table[ii][tage_idx[ii]].u == 0){
+                alloc = ii;
+                break;
+            }
+        }
+        if(alloc >= 0){
+            Tage_Entry *entry = &tage_table[alloc][tage_idx[alloc]];
+            entry->tag = tage_tag[alloc];
+            entry->ctr = resolveDir ? 0 : -1;
+            entry->u = 0;
+        }
+        else {
+            for(int ii = start; ii < TAGE_NUM_TABLES; ii++)
+                tage_table[ii][tage_idx[ii]].u = SatDecrement(tage_table[ii][tage_idx[ii]].u);
+        }
+    }
+
+    // Periodically age the useful bits so stale entries can be replaced
+    if(++tage_tick >= TAGE_U_RESET){
+        tage_tick = 0;
+        for(int ii = 0; ii < TAGE_NUM_TABLES; ii++)
+            for(int jj = 0; jj < (1 << TAGE_LOG_ENTRIES); jj++)
+                tage_table[ii][jj].u >>= 1;
+    }
+
+    TageUpdateHistory(resolveDir);
+}
+
+void BPRED::TageUpdateHistory(bool resolveDir)
+{
+    tage_hist_ptr = (tage_hist_ptr - 1) & (TAGE_HIST_BUF - 1);
+    tage_hist[tage_hist_ptr] = resolveDir;
+    for(int ii = 0; ii < TAGE_NUM_TABLES; ii++){
+        FoldedUpdate(&tage_fold_idx[ii], tage_hist, tage_hist_ptr);
+        FoldedUpdate(&tage_fold_tag[0][ii], tage_hist, tage_hist_ptr);
+        FoldedUpdate(&tage_fold_tag[1][ii], tage_hist, tage_hist_ptr);
+    }
+}
@@ -3,6 +3,20 @@
 #include <inttypes.h>
 #include <map>
 
+// Perceptron predictor geometry
+#define PERC_HIST_LEN    32      // Global history bits fed to each perceptron (multiple of 16)
+#define PERC_NUM_ROWS    1024    // Number of perceptrons, indexed by hashed PC
+#define PERC_WEIGHT_MAX  127     // Weights saturate at +/-127 so they can be negated in 8 bits
+#define PERC_THRESHOLD   75      // Training threshold, floor(1.93 * PERC_HIST_LEN + 14)
+
+// TAGE predictor geometry
+#define TAGE_NUM_TABLES  4       // Tagged tables, history lengths grow geometrically
+#define TAGE_LOG_BASE    13      // Entries in the bimodal base table (log2)
+#define TAGE_LOG_ENTRIES 10      // Entries per tagged table (log2)
+#define TAGE_TAG_BITS    9       // Partial tag width
+#define TAGE_HIST_BUF    256     // Circular global history buffer, power of two > longest history
+#define TAGE_U_RESET     (1<<18) // Branches between graceful resets of the useful bits
+#define TAGE_USE_ALT_MAX 7       // use_alt_on_na counter range [-8, 7]
 
 
 static inline uint32_t SatIncrement(uint32_t x, uint32_t max)
@@ -23,9 +37,26 @@ typedef enum BPRED_TYPE_ENUM {
     BPRED_PERFECT=0,
     BPRED_ALWAYS_TAKEN=1,
     BPRED_GSHARE=2,
-    NUM_BPRED_TYPE=3
+    BPRED_PERCEPTRON=3,
+    BPRED_TAGE=4,
+    NUM_BPRED_TYPE=5
 } BPRED_TYPE;
 
+/* TAGE tagged table entry, packed into 4 bytes */
+typedef struct Tage_Entry_Struct {
+    uint16_t tag;       // Partial tag, 0 marks an empty entry
+    int8_t   ctr;       // 3-bit signed prediction counter, taken when >= 0
+    uint8_t  u;         // 2-bit useful counter
+} Tage_Entry;
+
+/* History folded down to an index/tag width, updated incrementally */
+typedef struct Folded_History_Struct {
+    uint32_t comp;      // Folded value
+    uint32_t clength;   // Folded width
+    uint32_t olength;   // Original history length
+    uint32_t outpoint;  // olength % clength
+} Folded_History;
+
 /////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////
 
@@ -48,6 +79,41 @@ class BPRED{
     void UpdateGHR(bool resolveDir);
     uint8_t GetPHTEntry(uint16_t hsh);
     void UpdatePHTEntry(uint16_t hsh, bool resolveDir);
+
+    //   Perceptron weights, one row of PERC_HIST_LEN weights per perceptron
+    int8_t perc_weights[PERC_NUM_ROWS][PERC_HIST_LEN];
+    int8_t perc_bias[PERC_NUM_ROWS];
+    //   Perceptron history as byte masks (0: taken, -1: not taken)
+    int8_t perc_hist[PERC_HIST_LEN];
+    //   Row and output of the last prediction, reused by the update
+    uint32_t perc_row;
+    int32_t perc_out;
+    bool PerceptronPredict(uint32_t PC);
+    void PerceptronUpdate(bool resolveDir);
+
+    //   TAGE bimodal base table (2-bit counters) and tagged tables
+    uint8_t tage_base[1 << TAGE_LOG_BASE];
+    Tage_Entry tage_table[TAGE_NUM_TABLES][1 << TAGE_LOG_ENTRIES];
+    //   Circular global history and its folded copies per table
+    uint8_t tage_hist[TAGE_HIST_BUF];
+    uint32_t tage_hist_ptr;
+    Folded_History tage_fold_idx[TAGE_NUM_TABLES];
+    Folded_History tage_fold_tag[2][TAGE_NUM_TABLES];
+    //   Lookup state of the last prediction, reused by the update
+    uint32_t tage_idx[TAGE_NUM_TABLES];
+    uint16_t tage_tag[TAGE_NUM_TABLES];
+    int32_t tage_provider;
+    int32_t tage_alt;
+    bool tage_provider_pred;
+    bool tage_alt_pred;
+    bool tage_provider_new;     // Provider is weak and not yet useful
+    int32_t tage_use_alt;       // 4-bit signed, >= 0: such a provider defers to the alternate
+    uint32_t tage_base_idx;
+    uint32_t tage_tick;
+    uint32_t tage_seed;
+    bool TagePredict(uint32_t PC);
+    void TageUpdate(bool resolveDir, bool predDir);
+    void TageUpdateHistory(bool resolveDir);
 };
 
 /***********************************************************/
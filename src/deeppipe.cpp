@@ -0,0 +1,421 @@
+/***********************************************************************
+ * File         : deeppipe.cpp
+ * Description  : Configurable depth in-order pipeline engine
+ **********************************************************************/
+
+#include "deeppipe.h"
+#include "evlog.h"
+#include <cstdlib>
+#include <string.h>
+#include <iostream>
+
+extern uint32_t PIPE_WIDTH;
+extern uint32_t ENABLE_MEM_FWD;
+extern uint32_t ENABLE_EXE_FWD;
+extern uint32_t BPRED_POLICY;
+extern uint32_t FE_DEPTH;
+extern uint32_t ID_DEPTH;
+extern uint32_t MEM_DEPTH;
+extern uint32_t ALU_LAT;
+extern uint32_t LD_LAT;
+extern uint32_t ST_LAT;
+extern uint32_t CBR_LAT;
+extern uint32_t REDIRECT_EX;
+extern uint32_t REF_HAZARD;
+
+static uint32_t round_pow2(uint32_t x)
+{
+  uint32_t r = 1;
+  while(r < x)
+    r <<= 1;
+  return r;
+}
+
+/**********************************************************************
+ * Allocate the rings and the scoreboard
+ **********************************************************************/
+
+void deep_init(Pipeline *p){
+  Deep_Pipe *d = (Deep_Pipe *) calloc (1, sizeof (Deep_Pipe));
+
+  d->ex_lat[OP_ALU]   = ALU_LAT;
+  d->ex_lat[OP_LD]    = LD_LAT;
+  d->ex_lat[OP_ST]    = ST_LAT;
+  d->ex_lat[OP_CBR]   = CBR_LAT;
+  d->ex_lat[OP_OTHER] = ALU_LAT;
+
+  uint32_t max_lat = 1;
+  for(int ii = 0; ii < NUM_OP_TYPE; ii++)
+    if(d->ex_lat[ii] > max_lat)
+      max_lat = d->ex_lat[ii];
+
+  d->fq_cap = FE_DEPTH * PIPE_WIDTH;
+  d->fq_mask = round_pow2(d->fq_cap) - 1;
+  d->fq = (Deep_Op *) calloc (d->fq_mask + 1, sizeof (Deep_Op));
+
+  // Room for every op in ID/EX/MEM plus one cycle of retire backlog
+  d->inflight_cap = PIPE_WIDTH * (ID_DEPTH + max_lat + MEM_DEPTH + 1);
+  d->inflight_mask = round_pow2(d->inflight_cap) - 1;
+  d->inflight = (Deep_Op *) calloc (d->inflight_mask + 1, sizeof (Deep_Op));
+
+  // -refhazard: the reference starts with every FE lane empty (and zeroed)
+  if(REF_HAZARD)
+    d->fe_stale_count = PIPE_WIDTH;
+
+  printf("** DEEP ENGINE FE:%u ID:%u MEM:%u EX(ALU/LD/ST/CBR):%u/%u/%u/%u REDIRECT:%s HAZARDS:%s **\n\n",
+         FE_DEPTH, ID_DEPTH, MEM_DEPTH, ALU_LAT, LD_LAT, ST_LAT, CBR_LAT, REDIRECT_EX ? "EX" : "WB",
+         REF_HAZARD ? "REFERENCE" : "SCOREBOARD");
+
+  p->deep = d;
+}
+
+
+/**********************************************************************
+ * Print which stage every in-flight op occupies
+ **********************************************************************/
+
+void deep_print_state(Pipeline *p){
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t ii;
+
+  std::cout << "--------------------------------------------" << std::endl;
+  std::cout <<"cycle count : " << p->stat_num_cycle << " retired_instruction : " << p->stat_retired_inst << std::endl;
+
+  printf(" FE: ");
+  for(ii = 0; ii < d->fq_count; ii++)
+    printf(" %6u ", (uint32_t)d->fq[(d->fq_head + ii) & d->fq_mask].op.op_id);
+  printf("\n");
+
+  const char *names[4] = {" ID: ", " EX: ", " MEM:", " WB: "};
+  for(uint32_t stage = ID_LATCH; stage <= NUM_LATCH_TYPES; stage++){
+    printf("%s", names[stage - ID_LATCH]);
+    for(ii = 0; ii < d->inflight_count; ii++){
+      Deep_Op *e = &d->inflight[(d->inflight_head + ii) & d->inflight_mask];
+      if(deep_op_stage(e, now) == stage)
+        printf(" %6u ", (uint32_t)e->op.op_id);
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+uint32_t deep_op_stage(const Deep_Op *e, uint64_t now){
+  uint64_t age = now - e->issue_cycle;
+  if(age < ID_DEPTH)
+    return ID_LATCH;
+  if(age < ID_DEPTH + e->ex_lat)
+    return EX_LATCH;
+  if(age < ID_DEPTH + e->ex_lat + MEM_DEPTH)
+    return MEM_LATCH;
+  return NUM_LATCH_TYPES;
+}
+
+
+/**********************************************************************
+ * Deep Engine Main Function: retire, issue, then fetch, in the same
+ * order pipe_cycle walks its stages
+ **********************************************************************/
+
+void deep_cycle(Pipeline *p)
+{
+  p->stat_num_cycle++;
+
+  deep_cycle_WB(p);
+  deep_cycle_ID(p);
+  deep_cycle_FE(p);
+}
+
+//--------------------------------------------------------------------//
+
+static void deep_evlog(const Deep_Op *e, uint64_t now){
+  Evlog_Op ev;
+  ev.op_id = e->op.op_id;
+  ev.pc = e->op.tr_entry.inst_addr;
+  ev.tid = e->tid;
+  ev.op_type = e->op.tr_entry.op_type;
+  ev.flags = e->ev_flags | (e->op.is_mispred_cbr ? EV_MISPRED : 0);
+  ev.cyc[EV_FETCH] = e->fetch_cycle;
+  ev.cyc[EV_DECODE] = e->issue_cycle;
+  ev.cyc[EV_EXECUTE] = e->issue_cycle + ID_DEPTH;
+  ev.cyc[EV_MEMORY] = ev.cyc[EV_EXECUTE] + e->ex_lat;
+  ev.cyc[EV_WRITEBACK] = e->done_cycle;
+  ev.cyc[EV_RETIRE] = now;
+  evlog_record(&ev);
+}
+
+void deep_cycle_WB(Pipeline *p){
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t ii;
+
+  for(ii = 0; ii < PIPE_WIDTH && d->inflight_count; ii++){
+    Deep_Op *e = &d->inflight[d->inflight_head];
+    if(e->done_cycle > now)
+      break;
+
+    p->stat_retired_inst++;
+    pipe_retire_sig(p, e->op.op_id);
+    if(e->op.op_id >= p->halt_op_id){
+      p->halt = true;
+    }
+    if(evlog_window.on && evlog_want(e->op.op_id, e->fetch_cycle))
+      deep_evlog(e, now);
+
+    d->inflight_head = (d->inflight_head + 1) & d->inflight_mask;
+    d->inflight_count--;
+  }
+}
+
+//--------------------------------------------------------------------//
+
+static inline bool deep_reg_ready(const Deep_Reg *r, uint64_t now)
+{
+  return now >= r->done || now == r->exe_fwd || now == r->mem_fwd;
+}
+
+static inline bool deep_src_ready(const Deep_Pipe *d, const Trace_Rec *tr, uint64_t now)
+{
+  if(tr->src1_needed && !deep_reg_ready(&d->reg[tr->src1_reg], now))
+    return false;
+  if(tr->src2_needed && !deep_reg_ready(&d->reg[tr->src2_reg], now))
+    return false;
+  if(tr->cc_read && !deep_reg_ready(&d->reg[DEEP_CC_REG], now))
+    return false;
+  return true;
+}
+
+// The head of the queue stalled, the ops that would have issued behind it wait too
+static void deep_stall_order(Deep_Pipe *d, uint32_t slots, uint64_t now)
+{
+  for(uint32_t jj = 1; jj < slots && jj < d->fq_count; jj++){
+    Deep_Op *f = &d->fq[(d->fq_head + jj) & d->fq_mask];
+    if(f->fetch_cycle + FE_DEPTH > now)
+      break;
+    f->ev_flags |= EV_STALL_ORDER;
+  }
+}
+
+// Move the head of the queue into ID and stamp its stage cycles
+static void deep_issue(Pipeline *p, uint64_t now)
+{
+  Deep_Pipe *d = p->deep;
+  Deep_Op *f = &d->fq[d->fq_head];
+  Trace_Rec *tr = &f->op.tr_entry;
+
+  uint32_t lat = d->ex_lat[tr->op_type < NUM_OP_TYPE ? (uint32_t)tr->op_type : (uint32_t)OP_OTHER];
+  uint64_t ex_end  = now + ID_DEPTH + lat - 1;     // Last EX cycle
+  uint64_t mem_end = ex_end + MEM_DEPTH;           // Last MEM cycle
+  uint64_t done    = mem_end + 1;                  // WB
+
+  // Cycles a dependent op may issue, given the enabled forwarding points
+  Deep_Reg ready;
+  ready.exe_fwd = (ENABLE_EXE_FWD && tr->op_type != OP_LD) ? ex_end : 0;
+  ready.mem_fwd = ENABLE_MEM_FWD ? mem_end : 0;
+  ready.done = done;
+
+  if(tr->dest_needed)
+    d->reg[tr->dest] = ready;
+  if(tr->cc_write)
+    d->reg[DEEP_CC_REG] = ready;
+
+  if(f->op.is_mispred_cbr)
+    d->fetch_resume_cycle = REDIRECT_EX ? ex_end + 1 : done;
+
+  Deep_Op *e = &d->inflight[(d->inflight_head + d->inflight_count) & d->inflight_mask];
+  *e = *f;
+  e->issue_cycle = now;
+  e->done_cycle = done;
+  e->ex_lat = lat;
+  d->inflight_count++;
+
+  d->fq_head = (d->fq_head + 1) & d->fq_mask;
+  d->fq_count--;
+}
+
+/**********************************************************************
+ * -refhazard: issue exactly when pipe_cycle_FE would. The EX and MEM
+ * latches are rebuilt from the in-flight ring and each FE lane, queued
+ * ops first and then the stale lanes as after the reference's sort,
+ * runs fe_dependence_check/fe_data_forwarding and the in-group checks
+ * as written there. Issue stops at the first lane that stalls.
+ **********************************************************************/
+
+static void deep_cycle_ID_ref(Pipeline *p){
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  Pipeline_Latch ex[MAX_PIPE_WIDTH], mem[MAX_PIPE_WIDTH], lane;
+  uint32_t num_ex = 0, num_mem = 0, ii, jj;
+  int dest_map[256] = {0};
+  bool cc_write = false;
+
+  // At unit depths EX and MEM hold the ops issued one and two cycles
+  // ago, the youngest in flight: walk back to the oldest of them
+  memset(ex, 0, sizeof(ex));
+  memset(mem, 0, sizeof(mem));
+  for(ii = d->inflight_count; ii > 0; ii--){
+    Deep_Op *e = &d->inflight[(d->inflight_head + ii - 1) & d->inflight_mask];
+    if(deep_op_stage(e, now) != EX_LATCH && deep_op_stage(e, now) != MEM_LATCH)
+      break;
+  }
+  for(; ii < d->inflight_count; ii++){
+    Deep_Op *e = &d->inflight[(d->inflight_head + ii) & d->inflight_mask];
+    if(deep_op_stage(e, now) == EX_LATCH && num_ex < MAX_PIPE_WIDTH)
+      ex[num_ex++] = e->op;
+    else if(num_mem < MAX_PIPE_WIDTH)
+      mem[num_mem++] = e->op;
+  }
+
+  uint32_t num_valid = d->fq_count < PIPE_WIDTH ? d->fq_count : PIPE_WIDTH;
+  uint32_t num_lanes = num_valid + d->fe_stale_count;
+  d->fe_free_count = 0;
+
+  for(ii = 0; ii < num_lanes; ii++){
+    bool valid = ii < num_valid;
+    if(valid)
+      lane = d->fq[d->fq_head].op;
+    else{
+      memset(&lane, 0, sizeof(lane));
+      lane.tr_entry = d->fe_stale[ii - num_valid];
+    }
+    Trace_Rec *tr = &lane.tr_entry;
+
+    lane.stall = false;
+    fe_dependence_check(&lane, ex, mem);
+    if(lane.stall && (ENABLE_EXE_FWD || ENABLE_MEM_FWD))
+      lane.stall = fe_data_forwarding(&lane, ex, mem);
+
+    // As pipe_cycle_FE: src1 only, whichever source is needed
+    if(tr->src1_needed || tr->src2_needed)
+      lane.stall |= (dest_map[tr->src1_reg] != 0);
+    if(tr->dest_needed)
+      dest_map[tr->dest]++;
+    lane.stall |= cc_write && tr->cc_read;
+    cc_write |= tr->cc_write;
+
+    if(lane.stall){
+      if(valid){
+        p->stat_stall_dep++;
+        d->fq[d->fq_head].ev_flags |= EV_STALL_DATA;
+        deep_stall_order(d, num_valid - ii, now);
+      }
+      break;
+    }
+    if(valid && d->inflight_count == d->inflight_cap){
+      d->fq[d->fq_head].ev_flags |= EV_STALL_STRUCT;
+      deep_stall_order(d, num_valid - ii, now);
+      break;
+    }
+
+    d->fe_free[d->fe_free_count++] = *tr;
+    if(valid)
+      deep_issue(p, now);
+  }
+
+  // Stale lanes from the one that stalled on keep their op
+  uint32_t kept = 0;
+  for(jj = ii > num_valid ? ii : num_valid; jj < num_lanes; jj++)
+    d->fe_stale[kept++] = d->fe_stale[jj - num_valid];
+  d->fe_stale_count = kept;
+}
+
+void deep_cycle_ID(Pipeline *p){
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t ii;
+
+  if(REF_HAZARD){
+    deep_cycle_ID_ref(p);
+    return;
+  }
+
+  // Issue in program order; the first op that cannot go stalls the rest
+  for(ii = 0; ii < PIPE_WIDTH && d->fq_count; ii++){
+    Deep_Op *f = &d->fq[d->fq_head];
+    Trace_Rec *tr = &f->op.tr_entry;
+
+    if(f->fetch_cycle + FE_DEPTH > now)
+      break;
+    if(!deep_src_ready(d, tr, now)){
+      p->stat_stall_dep++;
+      f->ev_flags |= EV_STALL_DATA;
+      deep_stall_order(d, PIPE_WIDTH - ii, now);
+      break;
+    }
+    if(d->inflight_count == d->inflight_cap){
+      f->ev_flags |= EV_STALL_STRUCT;
+      deep_stall_order(d, PIPE_WIDTH - ii, now);
+      break;
+    }
+
+    deep_issue(p, now);
+  }
+}
+
+//--------------------------------------------------------------------//
+
+// -refhazard: freed lanes fetch did not refill go stale, ahead of the kept
+// ones. Past the end of the trace pipe_cycle_FE empties them instead.
+static void deep_fe_stale(Deep_Pipe *d, uint32_t fetched, bool empty){
+  Trace_Rec lanes[MAX_PIPE_WIDTH];
+  uint32_t count = 0, ii;
+
+  for(ii = fetched; ii < d->fe_free_count; ii++){
+    lanes[count] = d->fe_free[ii];
+    if(empty)
+      memset(&lanes[count], 0, sizeof(Trace_Rec));
+    count++;
+  }
+  for(ii = 0; ii < d->fe_stale_count; ii++)
+    lanes[count++] = d->fe_stale[ii];
+  memcpy(d->fe_stale, lanes, count * sizeof(Trace_Rec));
+  d->fe_stale_count = count;
+  d->fe_free_count = 0;
+}
+
+void deep_cycle_FE(Pipeline *p){
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t fetched = 0;
+
+  if(p->fetch_cbr_stall){
+    if(now < d->fetch_resume_cycle){
+      p->stat_stall_cbr++;
+      if(REF_HAZARD)
+        deep_fe_stale(d, 0, false);
+      return;
+    }
+    p->fetch_cbr_stall = false;
+  }
+
+  // Under -refhazard only the lanes issue freed take new ops
+  uint32_t limit = REF_HAZARD ? d->fe_free_count : PIPE_WIDTH;
+  while(fetched < limit && d->fq_count < d->fq_cap && !d->trace_done){
+    Deep_Op *f = &d->fq[(d->fq_head + d->fq_count) & d->fq_mask];
+
+    //Fetch Instruction
+    pipe_get_fetch_op(p, &f->op);
+    if(!f->op.valid){
+      d->trace_done = true;
+      break;
+    }
+    f->tid = 0;
+    f->ev_flags = 0;
+    f->fetch_cycle = now;
+    d->fq_count++;
+    fetched++;
+
+    //Branch prediction, fetch stays off until the mispredict resolves
+    if(BPRED_POLICY && f->op.tr_entry.op_type == OP_CBR)
+      pipe_check_bpred(p, &f->op);
+    if(p->fetch_cbr_stall){
+      d->fetch_resume_cycle = (uint64_t)-1;
+      break;
+    }
+  }
+
+  if(REF_HAZARD)
+    deep_fe_stale(d, fetched, d->trace_done && !p->fetch_cbr_stall);
+}
+
+//--------------------------------------------------------------------//
@@ -0,0 +1,105 @@
+#ifndef _DEEPPIPE_H
+#define _DEEPPIPE_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "pipeline.h"
+
+#define DEEP_CC_REG    256                // Condition codes tracked as one extra register
+#define DEEP_NUM_REGS  (DEEP_CC_REG + 1)
+
+
+/*********************************************************************
+* Deep Pipeline Engine
+*
+* Generalizes the five stage reference pipeline to FE_DEPTH front-end
+* stages, ID_DEPTH decode stages, a per-op-type EX latency and
+* MEM_DEPTH memory stages. Instead of shifting latches every cycle,
+* each op is stamped with the cycle it becomes issuable, the cycle its
+* result can be forwarded and the cycle it retires, and sits in one of
+* two rings until then. A per-register scoreboard of those cycles
+* replaces the latch-by-latch dependence scan, so a cycle costs
+* O(width) regardless of depth. As in the reference, a value can be
+* forwarded only while its producer sits in the last EX stage or the
+* last MEM stage, and is otherwise visible once the producer retires.
+*
+* The scoreboard models the hazards as intended, so even at the default
+* depths (1/1/1), unit latencies and redirect at WB its timing is not
+* pipe_cycle's. pipe_cycle_FE differs in that:
+* - the in-group check tests dest_map[src1_reg] twice, whenever either
+*   source is needed, and never src2: an op waits on an older op in its
+*   own FE group writing a src1 it does not read, and not on one
+*   writing the src2 it does read;
+* - fe_data_forwarding returns on the first EX (then MEM) latch lane
+*   that matches any source, so one forwardable source lets the op go
+*   although another still waits on an unforwarded producer (e.g. EX
+*   forwarding alone with a second producer in MEM, or MEM forwarding
+*   alone with one in EX);
+* - a LD earlier in the EX latch that matches first makes it stall even
+*   when a younger non-LD producer in EX could forward the value;
+* - the invalid lanes a mispredict leaves in the FE latch keep their
+*   old op and still run the checks, so a stale source there can keep
+*   fetch from refilling them.
+* On traces that hit these, -validate reports the first such cycle.
+*
+* -refhazard (default depths only) trades the scoreboard for the
+* reference's own checks: the issue stage rebuilds the EX and MEM
+* latches from the youngest in-flight ops, tracks those stale lanes
+* and runs fe_dependence_check/fe_data_forwarding lane by lane, so the
+* timing is pipe_cycle's. Validating with it checks everything but the
+* scoreboard.
+**********************************************************************/
+
+/* Scoreboard entry: when the youngest in-flight producer's value is visible */
+typedef struct Deep_Reg_Struct {
+  uint64_t exe_fwd;               // Cycle it can forward from EX (0: never)
+  uint64_t mem_fwd;               // Cycle it can forward from MEM (0: never)
+  uint64_t done;                  // Cycle it retires, visible from then on
+} Deep_Reg;
+
+typedef struct Deep_Op_Struct {
+  Pipeline_Latch op;
+  uint64_t fetch_cycle;           // Cycle the op entered the front end
+  uint64_t issue_cycle;           // Cycle the op entered ID
+  uint64_t done_cycle;            // First cycle the op may retire
+  uint32_t ex_lat;                // EX latency of this op
+  uint8_t  tid;                   // Hardware thread (SMT mode)
+  uint8_t  ev_flags;              // EV_STALL_* reasons seen, for the event log
+} Deep_Op;
+
+typedef struct Deep_Pipe_Struct {
+  Deep_Op  *fq;                   // Front-end queue (fetched, not yet issued)
+  uint32_t fq_mask;
+  uint32_t fq_cap;                // FE_DEPTH * PIPE_WIDTH
+  uint32_t fq_head;
+  uint32_t fq_count;
+
+  Deep_Op  *inflight;             // Issued, not yet retired, in program order
+  uint32_t inflight_mask;
+  uint32_t inflight_cap;
+  uint32_t inflight_head;
+  uint32_t inflight_count;
+
+  Deep_Reg reg[DEEP_NUM_REGS];        // Scoreboard
+  uint32_t ex_lat[NUM_OP_TYPE];       // EX latency per Op_Type
+  uint64_t fetch_resume_cycle;        // Cycle fetch restarts after a mispredict
+  bool trace_done;
+
+  // -refhazard: invalid FE latch lanes, which follow the queued ops
+  Trace_Rec fe_stale[MAX_PIPE_WIDTH];   // Op each stale lane last held
+  uint32_t  fe_stale_count;
+  Trace_Rec fe_free[MAX_PIPE_WIDTH];    // Lanes freed by issue this cycle, in lane order
+  uint32_t  fe_free_count;
+}Deep_Pipe;
+
+void deep_init(Pipeline *p);                        // Allocate Deep Engine Structures
+void deep_cycle(Pipeline *p);                       // Runs one Deep Pipeline Cycle
+void deep_cycle_WB(Pipeline *p);                    // In-order Retire
+void deep_cycle_ID(Pipeline *p);                    // In-order Issue
+void deep_cycle_FE(Pipeline *p);                    // Fetch
+
+void deep_print_state(Pipeline *p);                 // Print Stage Occupancy
+uint32_t deep_op_stage(const Deep_Op *e, uint64_t now); // ID/EX/MEM_LATCH, NUM_LATCH_TYPES once done
+
+#endif
@@ -0,0 +1,175 @@
+/***********************************************************************
+ * File         : evlog.cpp
+ * Description  : Binary per-op pipeline event log
+ **********************************************************************/
+
+#include "evlog.h"
+#include <cstdlib>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+Evlog_Window evlog_window = { false, 0, (uint64_t)-1, 0, (uint64_t)-1 };
+
+typedef struct Evlog_Block_Struct {
+  uint8_t  data[EVLOG_BUF_BYTES];
+  uint32_t bytes;                 // Encoded bytes in data
+  uint32_t count;                 // Records in data
+  bool     full;                  // Owned by the writer when set
+} Evlog_Block;
+
+typedef struct Evlog_Struct {
+  FILE *file;
+  Evlog_Block block[EVLOG_NUM_BUFS];
+  uint32_t prod_idx;              // Block the simulator encodes into
+  uint32_t cons_idx;              // Next block the writer drains
+  bool stop;                      // Writer exits once all blocks are drained
+
+  // Delta state, reset at every block
+  uint64_t prev_op_id;
+  uint64_t prev_pc;
+  uint64_t prev_fetch;
+
+  uint64_t stat_records;
+  uint64_t stat_bytes;
+
+  std::thread writer;
+  std::mutex lock;
+  std::condition_variable cv;
+} Evlog;
+
+static Evlog *evlog = NULL;
+static Evlog_Op evlog_slots[EVLOG_SLOTS];
+
+/**********************************************************************
+ * Writer thread: write full blocks in order until asked to stop
+ **********************************************************************/
+
+static void evlog_write(Evlog *ev)
+{
+  for(;;){
+    Evlog_Block *b = &ev->block[ev->cons_idx];
+    {
+      std::unique_lock<std::mutex> guard(ev->lock);
+      ev->cv.wait(guard, [&]{ return b->full || ev->stop; });
+      if(!b->full)
+        return;
+    }
+
+    uint32_t hdr[2] = { b->bytes, b->count };
+    fwrite(hdr, sizeof(hdr), 1, ev->file);
+    fwrite(b->data, 1, b->bytes, ev->file);
+
+    {
+      std::lock_guard<std::mutex> guard(ev->lock);
+      b->full = false;
+    }
+    ev->cv.notify_all();
+    ev->cons_idx = (ev->cons_idx + 1) % EVLOG_NUM_BUFS;
+  }
+}
+
+/**********************************************************************
+ * Simulator side. evlog_close is also registered with atexit so a run
+ * stopped by die_message still flushes and ends on a whole block.
+ **********************************************************************/
+
+bool evlog_open(const char *filename, uint32_t engine, uint32_t width)
+{
+  FILE *file = fopen(filename, "wb");
+  if(!file)
+    return false;
+
+  uint32_t hdr[4] = { EVLOG_MAGIC, EVLOG_VERSION, engine, width };
+  fwrite(hdr, sizeof(hdr), 1, file);
+
+  evlog = new Evlog();
+  evlog->file = file;
+  evlog->writer = std::thread(evlog_write, evlog);
+  evlog_window.on = true;
+  atexit(evlog_close);
+  return true;
+}
+
+// Hand the current block to the writer and wait for the next one to drain
+static void evlog_submit(Evlog *ev)
+{
+  Evlog_Block *b = &ev->block[ev->prod_idx];
+  if(!b->count)
+    return;
+  {
+    std::lock_guard<std::mutex> guard(ev->lock);
+    b->full = true;
+  }
+  ev->cv.notify_all();
+
+  ev->prod_idx = (ev->prod_idx + 1) % EVLOG_NUM_BUFS;
+  b = &ev->block[ev->prod_idx];
+  {
+    std::unique_lock<std::mutex> guard(ev->lock);
+    ev->cv.wait(guard, [&]{ return !b->full; });
+  }
+  b->bytes = 0;
+  b->count = 0;
+  ev->prev_op_id = 0;
+  ev->prev_pc = 0;
+  ev->prev_fetch = 0;
+}
+
+void evlog_record(const Evlog_Op *rec)
+{
+  Evlog *ev = evlog;
+  Evlog_Block *b = &ev->block[ev->prod_idx];
+  if(b->bytes > EVLOG_BUF_BYTES - EVLOG_MAX_REC){
+    evlog_submit(ev);
+    b = &ev->block[ev->prod_idx];
+  }
+
+  uint8_t *out = b->data + b->bytes;
+  out = evlog_put(out, evlog_zigzag((int64_t)(rec->op_id - ev->prev_op_id)));
+  out = evlog_put(out, rec->tid);
+  out = evlog_put(out, evlog_zigzag((int64_t)(rec->pc - ev->prev_pc)));
+  out = evlog_put(out, rec->op_type | (rec->flags << 3));
+  out = evlog_put(out, evlog_zigzag((int64_t)(rec->cyc[EV_FETCH] - ev->prev_fetch)));
+  for(int ii = EV_DECODE; ii < EV_NUM_STAGES; ii++)
+    out = evlog_put(out, rec->cyc[ii] - rec->cyc[ii-1]);
+
+  ev->stat_bytes += (out - b->data) - b->bytes;
+  ev->stat_records++;
+  b->bytes = out - b->data;
+  b->count++;
+  ev->prev_op_id = rec->op_id;
+  ev->prev_pc = rec->pc;
+  ev->prev_fetch = rec->cyc[EV_FETCH];
+}
+
+void evlog_close(void)
+{
+  Evlog *ev = evlog;
+  if(!ev)
+    return;
+
+  evlog_submit(ev);
+  {
+    std::lock_guard<std::mutex> guard(ev->lock);
+    ev->stop = true;
+  }
+  ev->cv.notify_all();
+  ev->writer.join();
+  fclose(ev->file);
+
+  printf("Event log: %llu ops, %llu bytes (%.2f bytes/op)\n",
+         (unsigned long long)ev->stat_records, (unsigned long long)ev->stat_bytes,
+         ev->stat_records ? (double)ev->stat_bytes / (double)ev->stat_records : 0.0);
+  delete ev;
+  evlog = NULL;
+  evlog_window.on = false;
+}
+
+// The reference latches carry no timestamps, so its ops keep their
+// stage cycles here while in flight
+Evlog_Op *evlog_slot(uint64_t op_id)
+{
+  return &evlog_slots[op_id & (EVLOG_SLOTS - 1)];
+}
@@ -0,0 +1,114 @@
+#ifndef _EVLOG_H
+#define _EVLOG_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#define EVLOG_MAGIC      0x4c564550   // "PEVL"
+#define EVLOG_VERSION    1
+#define EVLOG_BUF_BYTES  (1 << 20)    // Encoded bytes per block
+#define EVLOG_NUM_BUFS   4            // Blocks in flight to the writer thread
+#define EVLOG_MAX_REC    96           // Upper bound on one encoded record
+#define EVLOG_SLOTS      256          // Reference engine side table, > ops in flight
+
+/* Stage timestamps kept per op */
+typedef enum Evlog_Stage_ENUM {
+    EV_FETCH,           // Entered the front end
+    EV_DECODE,          // Entered ID (in-order) / renamed (OoO)
+    EV_EXECUTE,         // Started EX
+    EV_MEMORY,          // Started MEM
+    EV_WRITEBACK,       // Result written back
+    EV_RETIRE,          // Retired
+    EV_NUM_STAGES
+} Evlog_Stage;
+
+/* Per-op flags, packed above the 3-bit op type */
+#define EV_MISPRED       0x01         // Mispredicted conditional branch
+#define EV_STALL_DATA    0x02         // Waited on a source operand
+#define EV_STALL_ORDER   0x04         // Waited behind an older stalled op
+#define EV_STALL_STRUCT  0x08         // Waited on a full ROB/IQ/LSQ
+#define EV_STALL_MEM     0x10         // Load waited on an older store
+
+
+/*********************************************************************
+* Pipeline Event Log
+*
+* With -eventlog <file> each retired op inside the window is recorded
+* with the cycle it entered every stage, its stall reasons and its
+* mispredict flag. Records are delta encoded (LEB128 varints, zigzag
+* for signed deltas) into a buffer owned by the simulator thread; full
+* buffers are handed to a writer thread, so the simulator never waits
+* on the file. Each block restarts the delta state and is decodable on
+* its own. evlog2txt turns a log into O3PipeView text for Konata.
+*
+* File   : u32 magic, u32 version, u32 engine, u32 width
+* Block  : u32 bytes, u32 records, records...
+* Record : op_id delta, tid, pc delta, op_type | flags << 3,
+*          fetch cycle delta, then one varint per later stage giving
+*          its distance from the previous stage
+**********************************************************************/
+
+typedef struct Evlog_Op_Struct {
+  uint64_t op_id;
+  uint64_t pc;
+  uint8_t  tid;
+  uint8_t  op_type;
+  uint8_t  flags;
+  uint64_t cyc[EV_NUM_STAGES];
+} Evlog_Op;
+
+typedef struct Evlog_Window_Struct {
+  bool     on;                    // -eventlog given
+  uint64_t op_lo, op_hi;          // Op id window (inclusive)
+  uint64_t cyc_lo, cyc_hi;        // Fetch cycle window (inclusive)
+} Evlog_Window;
+
+extern Evlog_Window evlog_window;
+
+static inline bool evlog_want(uint64_t op_id, uint64_t fetch_cycle)
+{
+  return op_id >= evlog_window.op_lo && op_id <= evlog_window.op_hi &&
+         fetch_cycle >= evlog_window.cyc_lo && fetch_cycle <= evlog_window.cyc_hi;
+}
+
+bool evlog_open(const char *filename, uint32_t engine, uint32_t width);
+void evlog_record(const Evlog_Op *rec);             // Encode one retired op
+void evlog_close(void);                             // Flush & join the writer
+Evlog_Op *evlog_slot(uint64_t op_id);               // Reference engine stamps
+
+/* Varint helpers shared with evlog2txt */
+static inline uint64_t evlog_zigzag(int64_t v)
+{
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t evlog_unzigzag(uint64_t v)
+{
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t *evlog_put(uint8_t *out, uint64_t v)
+{
+  while(v >= 0x80){
+    *out++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  *out++ = (uint8_t)v;
+  return out;
+}
+
+static inline const uint8_t *evlog_get(const uint8_t *in, const uint8_t *end, uint64_t *v)
+{
+  uint64_t r = 0;
+  for(int shift = 0; in < end && shift < 64; shift += 7){
+    uint8_t b = *in++;
+    r |= (uint64_t)(b & 0x7f) << shift;
+    if(!(b & 0x80)){
+      *v = r;
+      return in;
+    }
+  }
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,143 @@
+/********************************************************************
+ * File         : evlog2txt.cpp
+ * Description  : Convert a simulator event log to O3PipeView text
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "trace.h"
+#include "evlog.h"
+
+void die_usage() {
+    printf("Usage : evlog2txt [options] <eventlog>\n\n");
+    printf("Convert a log written with -eventlog to gem5 O3PipeView text (loads in Konata)\n");
+    printf("Options\n");
+    printf("   -ticks       <num>    Ticks per cycle in the output (Default: 1000)\n");
+    printf("   -csv                  Print one comma separated line per op instead\n");
+    exit(1);
+}
+
+static const char *op_names[NUM_OP_TYPE] = {"ALU", "LD", "ST", "CBR", "OTHER"};
+
+/*********************************************************************
+ * Print one op. O3PipeView has no MEM stage, so decode, rename and
+ * dispatch all show the ID/rename cycle and complete shows writeback.
+ *********************************************************************/
+
+static void print_o3(const Evlog_Op *ev, uint64_t seq, uint64_t ticks)
+{
+    char disasm[64];
+    uint32_t type = ev->op_type < NUM_OP_TYPE ? (uint32_t)ev->op_type : (uint32_t)OP_OTHER;
+
+    snprintf(disasm, sizeof(disasm), "T%u #%llu %s%s%s%s%s%s", ev->tid,
+             (unsigned long long)ev->op_id, op_names[type],
+             (ev->flags & EV_MISPRED)      ? " mispred"     : "",
+             (ev->flags & EV_STALL_DATA)   ? " stall:data"  : "",
+             (ev->flags & EV_STALL_ORDER)  ? " stall:order" : "",
+             (ev->flags & EV_STALL_STRUCT) ? " stall:full"  : "",
+             (ev->flags & EV_STALL_MEM)    ? " stall:store" : "");
+
+    printf("O3PipeView:fetch:%llu:0x%016llx:0:%llu:%s\n",
+           (unsigned long long)(ev->cyc[EV_FETCH] * ticks), (unsigned long long)ev->pc,
+           (unsigned long long)seq, disasm);
+    printf("O3PipeView:decode:%llu\n",   (unsigned long long)(ev->cyc[EV_DECODE] * ticks));
+    printf("O3PipeView:rename:%llu\n",   (unsigned long long)(ev->cyc[EV_DECODE] * ticks));
+    printf("O3PipeView:dispatch:%llu\n", (unsigned long long)(ev->cyc[EV_DECODE] * ticks));
+    printf("O3PipeView:issue:%llu\n",    (unsigned long long)(ev->cyc[EV_EXECUTE] * ticks));
+    printf("O3PipeView:complete:%llu\n", (unsigned long long)(ev->cyc[EV_WRITEBACK] * ticks));
+    printf("O3PipeView:retire:%llu:store:%llu\n", (unsigned long long)(ev->cyc[EV_RETIRE] * ticks),
+           (unsigned long long)(type == OP_ST ? ev->cyc[EV_RETIRE] * ticks : 0));
+}
+
+static void print_csv(const Evlog_Op *ev)
+{
+    printf("%u,%llu,0x%llx,%u,%u", ev->tid, (unsigned long long)ev->op_id,
+           (unsigned long long)ev->pc, ev->op_type, ev->flags);
+    for(int ii = 0; ii < EV_NUM_STAGES; ii++)
+        printf(",%llu", (unsigned long long)ev->cyc[ii]);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = NULL;
+    uint64_t ticks = 1000;
+    bool csv = false;
+    int ii;
+
+    for (ii = 1; ii < argc; ii++) {
+        if (!strcmp(argv[ii], "-h") || !strcmp(argv[ii], "-help")) {
+            die_usage();
+        }
+        else if (!strcmp(argv[ii], "-ticks") && ii < argc - 1) {
+            ticks = strtoull(argv[++ii], NULL, 10);
+        }
+        else if (!strcmp(argv[ii], "-csv")) {
+            csv = true;
+        }
+        else {
+            name = argv[ii];
+        }
+    }
+    if (!name || !ticks) {
+        die_usage();
+    }
+
+    FILE *file = fopen(name, "rb");
+    if (!file) {
+        printf("Error! Unable to open %s. Exiting...\n", name);
+        return 1;
+    }
+    uint32_t hdr[4];
+    if (fread(hdr, sizeof(hdr), 1, file) != 1 || hdr[0] != EVLOG_MAGIC || hdr[1] != EVLOG_VERSION) {
+        printf("Error! %s is not a simulator event log. Exiting...\n", name);
+        return 1;
+    }
+    if (csv) {
+        printf("# engine %u width %u\n", hdr[2], hdr[3]);
+        printf("tid,op_id,pc,op_type,flags,fetch,decode,execute,memory,writeback,retire\n");
+    }
+
+    // Decode block by block, each one starts from a zero delta state
+    std::vector<uint8_t> data;
+    uint64_t seq = 0;
+    uint32_t blk[2];
+    while (fread(blk, sizeof(blk), 1, file) == 1) {
+        data.resize(blk[0]);
+        if (fread(data.data(), 1, blk[0], file) != blk[0]) {
+            fprintf(stderr, "evlog2txt: truncated block, stopping\n");
+            break;
+        }
+
+        const uint8_t *in = data.data(), *end = in + blk[0];
+        Evlog_Op ev;
+        memset(&ev, 0, sizeof(ev));
+        for (uint32_t rr = 0; rr < blk[1]; rr++) {
+            uint64_t v[EV_NUM_STAGES + 4];
+            for (int kk = 0; kk < EV_NUM_STAGES + 4 && in; kk++)
+                in = evlog_get(in, end, &v[kk]);
+            if (!in) {
+                fprintf(stderr, "evlog2txt: corrupt record, skipping rest of block\n");
+                break;
+            }
+            ev.op_id += evlog_unzigzag(v[0]);
+            ev.tid = (uint8_t)v[1];
+            ev.pc += evlog_unzigzag(v[2]);
+            ev.op_type = v[3] & 7;
+            ev.flags = (uint8_t)(v[3] >> 3);
+            ev.cyc[EV_FETCH] += evlog_unzigzag(v[4]);
+            for (int kk = EV_DECODE; kk < EV_NUM_STAGES; kk++)
+                ev.cyc[kk] = ev.cyc[kk-1] + v[4 + kk];
+
+            if (csv)
+                print_csv(&ev);
+            else
+                print_o3(&ev, ++seq, ticks);
+        }
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,400 @@
+/***********************************************************************
+ * File         : ooopipe.cpp
+ * Description  : Out-of-order back end with bitmap wakeup/select
+ **********************************************************************/
+
+#include "ooopipe.h"
+#include "evlog.h"
+#include <cstdlib>
+#include <iostream>
+
+extern uint32_t PIPE_WIDTH;
+extern uint32_t FE_DEPTH;
+extern uint32_t ID_DEPTH;
+extern uint32_t MEM_DEPTH;
+extern uint32_t REDIRECT_EX;
+extern uint32_t ROB_SIZE;
+extern uint32_t IQ_SIZE;
+extern uint32_t LSQ_SIZE;
+extern uint32_t ISSUE_WIDTH;
+
+/**********************************************************************
+ * Bitmap helpers, all bitmaps are indexed by ROB slot
+ **********************************************************************/
+
+static inline void bm_set(uint64_t *bm, uint32_t idx)
+{
+  bm[idx >> 6] |= 1ULL << (idx & 63);
+}
+
+static inline void bm_clear(uint64_t *bm, uint32_t idx)
+{
+  bm[idx >> 6] &= ~(1ULL << (idx & 63));
+}
+
+static inline bool bm_test(const uint64_t *bm, uint32_t idx)
+{
+  return (bm[idx >> 6] >> (idx & 63)) & 1;
+}
+
+// Any bit set in [lo, hi)
+static bool bm_range_any(const uint64_t *bm, uint32_t lo, uint32_t hi)
+{
+  if(lo >= hi)
+    return false;
+  uint32_t lw = lo >> 6;
+  uint32_t hw = (hi - 1) >> 6;
+  uint64_t lmask = ~0ULL << (lo & 63);
+  uint64_t hmask = ~0ULL >> (63 - ((hi - 1) & 63));
+  if(lw == hw)
+    return (bm[lw] & lmask & hmask) != 0;
+  if(bm[lw] & lmask)
+    return true;
+  for(uint32_t w = lw + 1; w < hw; w++)
+    if(bm[w])
+      return true;
+  return (bm[hw] & hmask) != 0;
+}
+
+static uint32_t round_pow2(uint32_t x)
+{
+  uint32_t r = 1;
+  while(r < x)
+    r <<= 1;
+  return r;
+}
+
+/**********************************************************************
+ * Allocate the ROB, scheduler bitmaps and completion wheel
+ **********************************************************************/
+
+void ooo_init(Pipeline *p){
+  if(!p->deep)
+    deep_init(p);
+
+  Ooo_Pipe *o = (Ooo_Pipe *) calloc (1, sizeof (Ooo_Pipe));
+  uint32_t ring = round_pow2(ROB_SIZE);
+
+  o->rob = (Ooo_Entry *) calloc (ring, sizeof (Ooo_Entry));
+  o->rob_mask = ring - 1;
+  o->words = (ring + 63) / 64;
+
+  uint32_t max_lat = MEM_DEPTH;
+  for(int ii = 0; ii < NUM_OP_TYPE; ii++)
+    if(p->deep->ex_lat[ii] + MEM_DEPTH > max_lat)
+      max_lat = p->deep->ex_lat[ii] + MEM_DEPTH;
+  o->wheel_mask = round_pow2(max_lat + 1) - 1;
+
+  o->ready     = (uint64_t *) calloc (o->words, sizeof (uint64_t));
+  o->unexec_st = (uint64_t *) calloc (o->words, sizeof (uint64_t));
+  o->wake      = (uint64_t *) calloc ((size_t)ring * o->words, sizeof (uint64_t));
+  o->wheel     = (uint64_t *) calloc ((size_t)(o->wheel_mask + 1) * o->words, sizeof (uint64_t));
+
+  uint32_t num_rat = DEEP_NUM_REGS * (p->smt ? p->smt->num_threads : 1);
+  o->rat = (int32_t *) malloc (num_rat * sizeof (int32_t));
+  for(uint32_t ii = 0; ii < num_rat; ii++)
+    o->rat[ii] = OOO_NO_PRODUCER;
+
+  if(!ISSUE_WIDTH)
+    ISSUE_WIDTH = PIPE_WIDTH;
+
+  printf("** OOO ENGINE ROB:%u IQ:%u LSQ:%u ISSUE:%u **\n\n", ROB_SIZE, IQ_SIZE, LSQ_SIZE, ISSUE_WIDTH);
+
+  p->ooo = o;
+}
+
+
+/**********************************************************************
+ * Print the ROB (useful for debugging)
+ **********************************************************************/
+
+void ooo_print_state(Pipeline *p){
+  Ooo_Pipe *o = p->ooo;
+  Deep_Pipe *d = p->deep;
+  uint32_t ii;
+
+  std::cout << "--------------------------------------------" << std::endl;
+  std::cout <<"cycle count : " << p->stat_num_cycle << " retired_instruction : " << p->stat_retired_inst << std::endl;
+
+  printf(" FE: ");
+  for(ii = 0; ii < d->fq_count; ii++)
+    printf(" %6u ", (uint32_t)d->fq[(d->fq_head + ii) & d->fq_mask].op.op_id);
+  printf("\n ROB (D:dispatched I:issued C:complete, * ready):\n");
+  for(ii = 0; ii < o->rob_count; ii++){
+    uint32_t idx = (o->rob_head + ii) & o->rob_mask;
+    Ooo_Entry *e = &o->rob[idx];
+    printf(" %6u%c%c", (uint32_t)e->op.op_id, "DIC"[e->state], bm_test(o->ready, idx) ? '*' : ' ');
+    if(ii % 8 == 7)
+      printf("\n");
+  }
+  printf("\n\n");
+}
+
+void ooo_print_stats(Pipeline *p, const char *header){
+  Ooo_Pipe *o = p->ooo;
+  printf("\n%s_OOO_ISSUED         \t : %10u" , header, (uint32_t)o->stat_issued);
+  printf("\n%s_OOO_FULL_ROB       \t : %10u" , header, (uint32_t)o->stat_full_rob);
+  printf("\n%s_OOO_FULL_IQ        \t : %10u" , header, (uint32_t)o->stat_full_iq);
+  printf("\n%s_OOO_FULL_LSQ       \t : %10u" , header, (uint32_t)o->stat_full_lsq);
+}
+
+
+/**********************************************************************
+ * OoO Engine Main Function
+ **********************************************************************/
+
+void ooo_cycle(Pipeline *p)
+{
+  p->stat_num_cycle++;
+
+  ooo_cycle_WB(p);
+  ooo_cycle_COMMIT(p);
+  ooo_cycle_ISSUE(p);
+  ooo_cycle_RENAME(p);
+  if(p->smt)
+    smt_cycle_FE(p);
+  else
+    deep_cycle_FE(p);
+}
+
+//--------------------------------------------------------------------//
+
+// A mispredicted branch resolved, let its thread fetch again this cycle
+static inline void ooo_redirect(Pipeline *p, const Ooo_Entry *e)
+{
+  if(p->smt)
+    smt_resolve_mispred(p, e->tid);
+  else
+    p->deep->fetch_resume_cycle = p->stat_num_cycle;
+}
+
+void ooo_cycle_WB(Pipeline *p){
+  Ooo_Pipe *o = p->ooo;
+  uint64_t now = p->stat_num_cycle;
+  uint64_t *slot = &o->wheel[(now & o->wheel_mask) * o->words];
+
+  for(uint32_t w = 0; w < o->words; w++){
+    uint64_t bits = slot[w];
+    slot[w] = 0;
+    while(bits){
+      uint32_t idx = (w << 6) + __builtin_ctzll(bits);
+      bits &= bits - 1;
+
+      Ooo_Entry *e = &o->rob[idx];
+      e->state = OOO_DONE;
+      if(e->op.tr_entry.op_type == OP_ST)
+        bm_clear(o->unexec_st, idx);
+      if(e->op.is_mispred_cbr && REDIRECT_EX)
+        ooo_redirect(p, e);
+
+      // Wake every op waiting on this producer
+      uint64_t *row = &o->wake[(size_t)idx * o->words];
+      for(uint32_t j = 0; j < o->words; j++){
+        uint64_t deps = row[j];
+        row[j] = 0;
+        while(deps){
+          uint32_t c = (j << 6) + __builtin_ctzll(deps);
+          deps &= deps - 1;
+          if(--o->rob[c].pending == 0)
+            bm_set(o->ready, c);
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------//
+
+static void ooo_evlog(const Ooo_Entry *e, uint64_t now){
+  Evlog_Op ev;
+  ev.op_id = e->op.op_id;
+  ev.pc = e->op.tr_entry.inst_addr;
+  ev.tid = e->tid;
+  ev.op_type = e->op.tr_entry.op_type;
+  ev.flags = e->ev_flags | (e->op.is_mispred_cbr ? EV_MISPRED : 0);
+  ev.cyc[EV_FETCH] = e->fetch_cycle;
+  ev.cyc[EV_DECODE] = e->dispatch_cycle;
+  ev.cyc[EV_EXECUTE] = e->issue_cycle;
+  ev.cyc[EV_MEMORY] = e->done_cycle - (ev.op_type == OP_LD ? MEM_DEPTH : 0);
+  ev.cyc[EV_WRITEBACK] = e->done_cycle;
+  ev.cyc[EV_RETIRE] = now;
+  evlog_record(&ev);
+}
+
+void ooo_cycle_COMMIT(Pipeline *p){
+  Ooo_Pipe *o = p->ooo;
+  uint32_t ii;
+
+  for(ii = 0; ii < PIPE_WIDTH && o->rob_count; ii++){
+    Ooo_Entry *e = &o->rob[o->rob_head];
+    Trace_Rec *tr = &e->op.tr_entry;
+    if(e->state != OOO_DONE)
+      break;
+
+    p->stat_retired_inst++;
+    pipe_retire_sig(p, e->op.op_id);
+    if(p->smt)
+      smt_retire(p, e->tid);
+    else if(e->op.op_id >= p->halt_op_id){
+      p->halt = true;
+    }
+    if(e->op.is_mispred_cbr && !REDIRECT_EX)
+      ooo_redirect(p, e);
+    if(evlog_window.on && evlog_want(e->op.op_id, e->fetch_cycle))
+      ooo_evlog(e, p->stat_num_cycle);
+
+    // Values of committed ops are read from the architectural state
+    int32_t *rat = &o->rat[e->tid * DEEP_NUM_REGS];
+    if(tr->dest_needed && rat[tr->dest] == (int32_t)o->rob_head)
+      rat[tr->dest] = OOO_NO_PRODUCER;
+    if(tr->cc_write && rat[DEEP_CC_REG] == (int32_t)o->rob_head)
+      rat[DEEP_CC_REG] = OOO_NO_PRODUCER;
+    if(tr->op_type == OP_LD || tr->op_type == OP_ST)
+      o->lsq_count--;
+
+    o->rob_head = (o->rob_head + 1) & o->rob_mask;
+    o->rob_count--;
+  }
+
+  if(p->smt)
+    smt_check_done(p);
+}
+
+//--------------------------------------------------------------------//
+
+// True if a store older than ROB slot idx has not executed yet
+static inline bool ooo_older_store(const Ooo_Pipe *o, uint32_t idx)
+{
+  if(o->rob_head <= idx)
+    return bm_range_any(o->unexec_st, o->rob_head, idx);
+  return bm_range_any(o->unexec_st, o->rob_head, o->rob_mask + 1) ||
+         bm_range_any(o->unexec_st, 0, idx);
+}
+
+void ooo_cycle_ISSUE(Pipeline *p){
+  Ooo_Pipe *o = p->ooo;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t issued = 0;
+  uint32_t start = o->rob_head;
+
+  // Walk the ready bitmap from the ROB head so older ops win. The last
+  // step revisits the head word for the slots that wrapped around.
+  for(uint32_t k = 0; k <= o->words && issued < ISSUE_WIDTH; k++){
+    uint32_t w = ((start >> 6) + k) % o->words;
+    uint64_t bits = o->ready[w];
+    if(k == 0)
+      bits &= ~0ULL << (start & 63);
+    else if(k == o->words)
+      bits &= ~(~0ULL << (start & 63));
+
+    while(bits && issued < ISSUE_WIDTH){
+      uint32_t idx = (w << 6) + __builtin_ctzll(bits);
+      bits &= bits - 1;
+
+      Ooo_Entry *e = &o->rob[idx];
+      if(e->dispatch_cycle + ID_DEPTH > now)
+        continue;
+      if(e->op.tr_entry.op_type == OP_LD && ooo_older_store(o, idx)){
+        e->ev_flags |= EV_STALL_MEM;
+        continue;
+      }
+
+      bm_clear(o->ready, idx);
+      e->state = OOO_ISSUED;
+      e->issue_cycle = now;
+      e->done_cycle = now + e->lat;
+      bm_set(&o->wheel[(e->done_cycle & o->wheel_mask) * o->words], idx);
+      o->iq_count--;
+      o->stat_issued++;
+      if(p->smt)
+        p->smt->thread[e->tid].icount--;
+      issued++;
+    }
+  }
+}
+
+//--------------------------------------------------------------------//
+
+static inline void ooo_add_source(Ooo_Pipe *o, const int32_t *rat, uint32_t idx, uint32_t reg)
+{
+  int32_t prod = rat[reg];
+  if(prod == OOO_NO_PRODUCER || o->rob[prod].state == OOO_DONE)
+    return;
+  uint64_t *row = &o->wake[(size_t)prod * o->words];
+  if(bm_test(row, idx))
+    return;
+  bm_set(row, idx);
+  o->rob[idx].pending++;
+}
+
+void ooo_cycle_RENAME(Pipeline *p){
+  Ooo_Pipe *o = p->ooo;
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t ii;
+
+  for(ii = 0; ii < PIPE_WIDTH && d->fq_count; ii++){
+    Deep_Op *f = &d->fq[d->fq_head];
+    Trace_Rec *tr = &f->op.tr_entry;
+    bool is_mem = (tr->op_type == OP_LD || tr->op_type == OP_ST);
+
+    if(f->fetch_cycle + FE_DEPTH > now)
+      break;
+    if(o->rob_count == ROB_SIZE){
+      o->stat_full_rob++;
+      f->ev_flags |= EV_STALL_STRUCT;
+      break;
+    }
+    if(o->iq_count == IQ_SIZE){
+      o->stat_full_iq++;
+      f->ev_flags |= EV_STALL_STRUCT;
+      break;
+    }
+    if(is_mem && o->lsq_count == LSQ_SIZE){
+      o->stat_full_lsq++;
+      f->ev_flags |= EV_STALL_STRUCT;
+      break;
+    }
+
+    uint32_t idx = (o->rob_head + o->rob_count) & o->rob_mask;
+    Ooo_Entry *e = &o->rob[idx];
+    uint32_t type = tr->op_type < NUM_OP_TYPE ? (uint32_t)tr->op_type : (uint32_t)OP_OTHER;
+    e->op = f->op;
+    e->tid = f->tid;
+    e->state = OOO_DISPATCHED;
+    e->pending = 0;
+    e->lat = d->ex_lat[type] + (type == OP_LD ? MEM_DEPTH : 0);
+    e->fetch_cycle = f->fetch_cycle;
+    e->dispatch_cycle = now;
+
+    // Read sources through the RAT before this op claims its own dest
+    int32_t *rat = &o->rat[e->tid * DEEP_NUM_REGS];
+    if(tr->src1_needed)
+      ooo_add_source(o, rat, idx, tr->src1_reg);
+    if(tr->src2_needed)
+      ooo_add_source(o, rat, idx, tr->src2_reg);
+    if(tr->cc_read)
+      ooo_add_source(o, rat, idx, DEEP_CC_REG);
+
+    if(tr->dest_needed)
+      rat[tr->dest] = idx;
+    if(tr->cc_write)
+      rat[DEEP_CC_REG] = idx;
+
+    e->ev_flags = f->ev_flags | (e->pending ? EV_STALL_DATA : 0);
+    if(e->pending == 0)
+      bm_set(o->ready, idx);
+    if(type == OP_ST)
+      bm_set(o->unexec_st, idx);
+
+    o->rob_count++;
+    o->iq_count++;
+    if(is_mem)
+      o->lsq_count++;
+
+    d->fq_head = (d->fq_head + 1) & d->fq_mask;
+    d->fq_count--;
+  }
+}
+
+//--------------------------------------------------------------------//
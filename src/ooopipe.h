@@ -0,0 +1,88 @@
+#ifndef _OOOPIPE_H
+#define _OOOPIPE_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "pipeline.h"
+#include "deeppipe.h"
+#include "smt.h"
+
+#define OOO_NO_PRODUCER (-1)
+
+
+/*********************************************************************
+* Out-of-Order Engine
+*
+* The front end (p->deep, deep_cycle_FE) and the latency table are
+* shared with the deep engine; loads add MEM_DEPTH to their EX latency.
+* Ops are renamed onto ROB entries (the RAT maps each architectural
+* register, plus the condition codes, to its youngest in-flight
+* producer), then wait in the issue queue. The scheduler is indexed
+* by ROB slot, so ring order is age order:
+*   - wake[p] is a bitmap of ROB slots waiting on producer p; on
+*     completion each set bit decrements that op's pending count.
+*   - ready is a bitmap of ops whose sources are all available; select
+*     walks it from the ROB head with count-trailing-zeros, so the
+*     oldest ready ops issue first without scanning the queue.
+*   - completions sit in a timing wheel of bitmaps keyed by cycle.
+* Loads issue only once every older store has executed. Results are
+* fully bypassed, so -enableexefwd/-enablememfwd do not apply. In SMT
+* mode (p->smt) threads share every queue and rename into separate
+* slices of the RAT.
+**********************************************************************/
+
+typedef enum Ooo_State_ENUM {
+    OOO_DISPATCHED,               // In the issue queue
+    OOO_ISSUED,                   // Executing
+    OOO_DONE                      // Result written back, waiting to commit
+} Ooo_State;
+
+typedef struct Ooo_Entry_Struct {
+  Pipeline_Latch op;
+  uint8_t  state;                 // Ooo_State
+  uint8_t  pending;               // Source operands not yet produced
+  uint8_t  tid;                   // Hardware thread (SMT mode)
+  uint8_t  ev_flags;              // EV_STALL_* reasons seen, for the event log
+  uint32_t lat;                   // Execution latency
+  uint64_t fetch_cycle;
+  uint64_t dispatch_cycle;
+  uint64_t issue_cycle;
+  uint64_t done_cycle;
+} Ooo_Entry;
+
+typedef struct Ooo_Pipe_Struct {
+  Ooo_Entry *rob;                 // Reorder buffer ring, ROB_SIZE used
+  uint32_t rob_mask;
+  uint32_t rob_head;
+  uint32_t rob_count;
+  uint32_t words;                 // uint64_t words per ROB-indexed bitmap
+
+  uint32_t iq_count;
+  uint32_t lsq_count;
+
+  int32_t  *rat;                  // Youngest producer ROB slot, or OOO_NO_PRODUCER,
+                                  // DEEP_NUM_REGS per thread
+  uint64_t *ready;                // Ops eligible for select
+  uint64_t *unexec_st;            // Stores that have not executed yet
+  uint64_t *wake;                 // Wakeup matrix, words per producer
+  uint64_t *wheel;                // Completion wheel, words per slot
+  uint32_t wheel_mask;
+
+  uint64_t stat_issued;
+  uint64_t stat_full_rob;         // Cycles rename stalled on a full ROB
+  uint64_t stat_full_iq;          // ... on a full issue queue
+  uint64_t stat_full_lsq;         // ... on a full load/store queue
+}Ooo_Pipe;
+
+void ooo_init(Pipeline *p);                         // Allocate OoO Engine Structures
+void ooo_cycle(Pipeline *p);                        // Runs one OoO Cycle
+void ooo_cycle_WB(Pipeline *p);                     // Completion & Wakeup
+void ooo_cycle_COMMIT(Pipeline *p);                 // In-order Commit
+void ooo_cycle_ISSUE(Pipeline *p);                  // Select
+void ooo_cycle_RENAME(Pipeline *p);                 // Rename & Dispatch
+
+void ooo_print_state(Pipeline *p);                  // Print ROB Contents
+void ooo_print_stats(Pipeline *p, const char *header);
+
+#endif
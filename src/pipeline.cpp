@@ -6,8 +6,10 @@
  **********************************************************************/
 
  #include "pipeline.h"
+ #include "evlog.h"
  #include <cstdlib>
  #include <algorithm>
+ #include <string.h>
  
  extern int32_t PIPE_WIDTH;
  extern int32_t ENABLE_MEM_FWD;
@@ -216,6 +218,14 @@ bool id_comp(Pipeline_Latch const &a, Pipeline_Latch const &b)
   return a.op_id < b.op_id;   
 }
 
+// Event log stamps of an in-flight op, NULL when not logged
+static inline Evlog_Op *pipe_evlog(uint64_t op_id){
+  if(!evlog_window.on || !op_id)
+    return NULL;
+  Evlog_Op *ev = evlog_slot(op_id);
+  return ev->op_id == op_id ? ev : NULL;
+}
+
 void pipe_cycle_WB(Pipeline *p){
   int ii;
   for(ii=0; ii<PIPE_WIDTH; ii++){
@@ -224,11 +234,22 @@ void pipe_cycle_WB(Pipeline *p){
     {
       if(stage->valid){
         p->stat_retired_inst++;
+        pipe_retire_sig(p, stage->op_id);
         if(stage->op_id >= p->halt_op_id){
           p->halt=true;
         }
         if(stage->is_mispred_cbr)
           p->fetch_cbr_stall = false;
+        if(Evlog_Op *ev = pipe_evlog(stage->op_id)){
+          ev->pc = stage->tr_entry.inst_addr;
+          ev->op_type = stage->tr_entry.op_type;
+          ev->flags |= stage->is_mispred_cbr ? EV_MISPRED : 0;
+          ev->cyc[EV_EXECUTE] = ev->cyc[EV_DECODE] + 1;
+          ev->cyc[EV_MEMORY] = ev->cyc[EV_DECODE] + 2;
+          ev->cyc[EV_WRITEBACK] = p->stat_num_cycle;
+          ev->cyc[EV_RETIRE] = p->stat_num_cycle;
+          evlog_record(ev);
+        }
       }
     }
   }
@@ -282,14 +303,22 @@ void pipe_cycle_FE(Pipeline *p){
   bool tr_read_success;
   bool prev_stall = false;
   bool cc_write = false;
+  bool dep_stall = false;
   int dest_map[255] = {0};
 
+  if(p->fetch_cbr_stall)
+    p->stat_stall_cbr++;
+
   for(ii=0; ii<PIPE_WIDTH; ii++)
   {
     Pipeline_Latch *stage = &p->pipe_latch[FE_LATCH][ii];
     // if the previous instruction stalled, this one must as well and we don't need to check its dependencies
-    if(prev_stall)
+    if(prev_stall){
       stage->stall = prev_stall;
+      if(stage->valid)
+        if(Evlog_Op *ev = pipe_evlog(stage->op_id))
+          ev->flags |= EV_STALL_ORDER;
+    }
     else
     {
       stage->stall = false;
@@ -316,6 +345,11 @@ void pipe_cycle_FE(Pipeline *p){
 
       // Set cc_write to check if any instruction after this one should be stalled individually
       cc_write |= stage->tr_entry.cc_write;
+
+      dep_stall |= stage->stall && stage->valid;
+      if(stage->stall && stage->valid)
+        if(Evlog_Op *ev = pipe_evlog(stage->op_id))
+          ev->flags |= EV_STALL_DATA;
     }
 
     // Based on stall value, set propagated instruction validity
@@ -327,17 +361,32 @@ void pipe_cycle_FE(Pipeline *p){
 
     if(!stage->stall)
     {
+      if(stage->valid)
+        if(Evlog_Op *ev = pipe_evlog(stage->op_id))
+          ev->cyc[EV_DECODE] = p->stat_num_cycle;
+
       if(!p->fetch_cbr_stall)
       {
         //Fetch Instruction
         pipe_get_fetch_op(p, &fetch_op);
         
         //Branch prediction
-        if(BPRED_POLICY && fetch_op.tr_entry.op_type == OP_CBR)
+        if(BPRED_POLICY && fetch_op.valid && fetch_op.tr_entry.op_type == OP_CBR)
           pipe_check_bpred(p, &fetch_op);
 
-        //Copy op into FE LATCH
-        p->pipe_latch[FE_LATCH][ii]=fetch_op;
+        if(evlog_window.on && fetch_op.valid && evlog_want(fetch_op.op_id, p->stat_num_cycle)){
+          Evlog_Op *ev = evlog_slot(fetch_op.op_id);
+          ev->op_id = fetch_op.op_id;
+          ev->tid = 0;
+          ev->flags = 0;
+          ev->cyc[EV_FETCH] = p->stat_num_cycle;
+        }
+
+        //Copy op into FE LATCH, past the end of the trace the lane is left empty
+        if(fetch_op.valid)
+          p->pipe_latch[FE_LATCH][ii]=fetch_op;
+        else
+          memset(&p->pipe_latch[FE_LATCH][ii], 0, sizeof(Pipeline_Latch));
       } else if(p->fetch_cbr_stall)
       {
           stage->valid = false;
@@ -346,6 +395,9 @@ void pipe_cycle_FE(Pipeline *p){
     }
   }
 
+  if(dep_stall)
+    p->stat_stall_dep++;
+
   // Sort using std's sort library
   if(PIPE_WIDTH > 0)
   {
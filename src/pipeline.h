@@ -35,10 +35,17 @@ typedef enum Latch_Type_ENUM {
 } Latch_Type; 
 
 
+struct Deep_Pipe_Struct;
+struct Ooo_Pipe_Struct;
+struct Smt_Pipe_Struct;
+
 typedef struct Pipeline {
   FILE *tr_file;
   Pipeline_Latch  pipe_latch[NUM_LATCH_TYPES][MAX_PIPE_WIDTH];// Pipeline Latches
   BPRED *b_pred;
+  struct Deep_Pipe_Struct *deep;  // Deep engine state (NULL for the reference engine)
+  struct Ooo_Pipe_Struct *ooo;    // OoO back end state (NULL unless -engine 2)
+  struct Smt_Pipe_Struct *smt;    // Per-thread state (NULL unless several traces)
   
   uint64_t op_id_tracker;         // a sequence number for OPs to track
   uint64_t halt_op_id;            // OpID of last inst in Trace
@@ -49,9 +56,18 @@ typedef struct Pipeline {
   /* Statistics: students need to update these counters*/
   uint64_t stat_retired_inst;         // Total Commited Instructions
   uint64_t stat_num_cycle;            // Total Cycles
+  uint64_t stat_stall_dep;            // Cycles the oldest op waited on a data hazard
+  uint64_t stat_stall_cbr;            // Cycles fetch waited on a mispredicted branch
+  uint64_t stat_retire_sig;           // Order-sensitive hash of the retired op ids
 }Pipeline;
 
+// Fold one retired op into stat_retire_sig (FNV-1a step)
+static inline void pipe_retire_sig(Pipeline *p, uint64_t op_id){
+  p->stat_retire_sig = (p->stat_retire_sig ^ op_id) * 0x100000001b3ULL;
+}
+
 Pipeline* pipe_init(FILE *tr_file);   // Allocate Structures
+void pipe_get_fetch_op(Pipeline *p, Pipeline_Latch* fetch_op); // Read one Trace Record
 
 void pipe_cycle(Pipeline *p);                        // Runs one Pipeline Cycle
 void pipe_cycle_FE(Pipeline *p);                    // Fetch Stage 
@@ -62,6 +78,10 @@ void pipe_cycle_WB(Pipeline *p);                    // WB Stage
 
 void pipe_check_bpred(Pipeline *p, Pipeline_Latch *fetch_op); // Branch Prediction Check
 
+// Hazard checks of a FE op against the EX/MEM latches (stall if true)
+void fe_dependence_check(Pipeline_Latch_Struct *festage, const Pipeline_Latch_Struct *exstage, const Pipeline_Latch_Struct *memstage);
+bool fe_data_forwarding(Pipeline_Latch_Struct *festage, const Pipeline_Latch_Struct *exstage, const Pipeline_Latch_Struct *memstage);
+
 void pipe_print_state(Pipeline *p);                 // Print Pipeline Latches
 
 #endif
@@ -10,6 +10,12 @@
 #include <assert.h>
 
 #include "pipeline.h"
+#include "deeppipe.h"
+#include "ooopipe.h"
+#include "smt.h"
+#include "telemetry.h"
+#include "evlog.h"
+#include "validate.h"
 
 #define HEARTBEAT_CYCLES 10000
 
@@ -24,13 +30,37 @@ void die_message(const char *msg) {
 }
 
 void die_usage() {
-    printf("Usage : sim [options] <trace_file> \n\n");
+    printf("Usage : sim [options] <trace_file> [<trace_file> ...]\n\n");
     printf("Trace driven pipeline simulator\n");
     printf("Options\n");
     printf("   -pipewidth   <num>    Set width of pipeline to <num> (Default: 1)\n");
     printf("   -enablememfwd         Enable forwarding from MEM stage (Default: off)\n");
     printf("   -enableexefwd         Enable forwarding from EXE stage (Default: off)\n");
-    printf("   -bpredpolicy <num>    Set branch predictor  [0:Perf 1:Taken 2:Gshare]\n");
+    printf("   -bpredpolicy <num>    Set branch predictor  [0:Perf 1:Taken 2:Gshare 3:Perceptron 4:TAGE]\n");
+    printf("   -engine      <num>    Set pipeline engine   [0:Reference 1:Deep 2:OoO] (Default: 0)\n");
+    printf("   -fedepth     <num>    Deep engine: front-end stages before issue (Default: 1)\n");
+    printf("   -iddepth     <num>    Deep engine: decode stages after issue (Default: 1)\n");
+    printf("   -memdepth    <num>    Deep engine: memory stages (Default: 1)\n");
+    printf("   -alulat      <num>    Deep engine: EX latency of ALU/other ops (Default: 1)\n");
+    printf("   -ldlat       <num>    Deep engine: EX latency of loads (Default: 1)\n");
+    printf("   -stlat       <num>    Deep engine: EX latency of stores (Default: 1)\n");
+    printf("   -cbrlat      <num>    Deep engine: EX latency of branches (Default: 1)\n");
+    printf("   -redirectex           Deep engine: redirect fetch after branch EX, not WB (Default: off)\n");
+    printf("   -refhazard            Deep engine: pipe_cycle's hazard checks, for its exact timing (Default: off)\n");
+    printf("   -robsize     <num>    OoO engine: reorder buffer entries (Default: 64)\n");
+    printf("   -iqsize      <num>    OoO engine: issue queue entries (Default: 32)\n");
+    printf("   -lsqsize     <num>    OoO engine: load/store queue entries (Default: 32)\n");
+    printf("   -issuewidth  <num>    OoO engine: ops selected per cycle (Default: pipewidth)\n");
+    printf("   -smtfetch    <num>    SMT fetch policy      [0:RoundRobin 1:ICOUNT] (Default: 0)\n");
+    printf("   -smtbpred    <num>    SMT branch predictor  [0:Shared 1:Partitioned] (Default: 0)\n");
+    printf("   -smtalone    <list>   SMT single-thread IPCs, comma separated, for fairness metrics\n");
+    printf("   -telemetry   <name>   Publish live counters in /dev/shm/<name> (watch with simwatch)\n");
+    printf("   -eventlog    <file>   Write a binary per-op event log (convert with evlog2txt)\n");
+    printf("   -eventops    <lo:hi>  Event log: only ops with lo <= op_id <= hi\n");
+    printf("   -eventcycles <lo:hi>  Event log: only ops fetched in cycles lo..hi\n");
+    printf("   -validate    <num>    Check -engine 1 against the reference model in lockstep, every cycle (1)\n");
+    printf("                         or one %u-cycle interval in <num>; other depths compare retired ops only\n", VALIDATE_INTERVAL);
+    printf("Passing 2-%d trace files runs them as SMT threads on the OoO engine (-engine 2)\n", SMT_MAX_THREADS);
 }
 
 void check_heartbeat(void);
@@ -44,7 +74,27 @@ void print_stats(void);
 uint32_t  PIPE_WIDTH=1;
 uint32_t  ENABLE_MEM_FWD=0;
 uint32_t  ENABLE_EXE_FWD=0;
-uint32_t  BPRED_POLICY=0; // 0:Perf 1:AlwaysTaken 2:Gshare
+uint32_t  BPRED_POLICY=0; // 0:Perf 1:AlwaysTaken 2:Gshare 3:Perceptron 4:TAGE
+uint32_t  PIPE_ENGINE=0;  // 0:Reference 1:Deep 2:OoO
+uint32_t  FE_DEPTH=1;
+uint32_t  ID_DEPTH=1;
+uint32_t  MEM_DEPTH=1;
+uint32_t  ALU_LAT=1;
+uint32_t  LD_LAT=1;
+uint32_t  ST_LAT=1;
+uint32_t  CBR_LAT=1;
+uint32_t  REDIRECT_EX=0;
+uint32_t  REF_HAZARD=0;
+uint32_t  ROB_SIZE=64;
+uint32_t  IQ_SIZE=32;
+uint32_t  LSQ_SIZE=32;
+uint32_t  ISSUE_WIDTH=0;  // 0: same as PIPE_WIDTH
+uint32_t  SMT_FETCH_POLICY=0; // 0:RoundRobin 1:ICOUNT
+uint32_t  SMT_BPRED_POLICY=0; // 0:Shared 1:Partitioned
+char     *SMT_ALONE_IPC=NULL;
+char     *TELEMETRY_NAME=NULL;
+char     *EVENT_LOG_NAME=NULL;
+uint32_t  VALIDATE_SAMPLE=0; // 0:Off 1:Every cycle N:One interval in N
 
 Pipeline *pipeline;
 /*********************************************************************
@@ -57,6 +107,8 @@ int main(int argc, char *argv[])
 
     FILE *tr_file;
     char tr_filename[1024];
+    char *tr_filenames[SMT_MAX_THREADS];
+    uint32_t num_traces = 0;
     char cmd_string[256];
     
     if(argc < 1) {
@@ -87,6 +139,158 @@ int main(int argc, char *argv[])
 		}
 	    }
 
+	    else if (!strcmp(argv[ii], "-engine")) {
+		if (ii < argc - 1) {
+		    PIPE_ENGINE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-fedepth")) {
+		if (ii < argc - 1) {
+		    FE_DEPTH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-iddepth")) {
+		if (ii < argc - 1) {
+		    ID_DEPTH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-memdepth")) {
+		if (ii < argc - 1) {
+		    MEM_DEPTH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-alulat")) {
+		if (ii < argc - 1) {
+		    ALU_LAT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-ldlat")) {
+		if (ii < argc - 1) {
+		    LD_LAT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-stlat")) {
+		if (ii < argc - 1) {
+		    ST_LAT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-cbrlat")) {
+		if (ii < argc - 1) {
+		    CBR_LAT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-redirectex")) {
+	      REDIRECT_EX = 1;
+	    }
+
+	    else if (!strcmp(argv[ii], "-refhazard")) {
+	      REF_HAZARD = 1;
+	    }
+
+	    else if (!strcmp(argv[ii], "-robsize")) {
+		if (ii < argc - 1) {
+		    ROB_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-iqsize")) {
+		if (ii < argc - 1) {
+		    IQ_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-lsqsize")) {
+		if (ii < argc - 1) {
+		    LSQ_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-issuewidth")) {
+		if (ii < argc - 1) {
+		    ISSUE_WIDTH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-smtfetch")) {
+		if (ii < argc - 1) {
+		    SMT_FETCH_POLICY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-smtbpred")) {
+		if (ii < argc - 1) {
+		    SMT_BPRED_POLICY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-smtalone")) {
+		if (ii < argc - 1) {
+		    SMT_ALONE_IPC = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-telemetry")) {
+		if (ii < argc - 1) {
+		    TELEMETRY_NAME = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-eventlog")) {
+		if (ii < argc - 1) {
+		    EVENT_LOG_NAME = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-eventops")) {
+		if (ii < argc - 1) {
+		    if (sscanf(argv[ii+1], "%" SCNu64 ":%" SCNu64, &evlog_window.op_lo, &evlog_window.op_hi) != 2) {
+			die_message("-eventops takes <lo:hi>");
+		    }
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-eventcycles")) {
+		if (ii < argc - 1) {
+		    if (sscanf(argv[ii+1], "%" SCNu64 ":%" SCNu64, &evlog_window.cyc_lo, &evlog_window.cyc_hi) != 2) {
+			die_message("-eventcycles takes <lo:hi>");
+		    }
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-validate")) {
+		if (ii < argc - 1) {
+		    VALIDATE_SAMPLE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
 	    else if (!strcmp(argv[ii], "-enablememfwd")) {
 	      ENABLE_MEM_FWD = 1;
 	    }
@@ -97,11 +301,43 @@ int main(int argc, char *argv[])
 	}
 	else {
 	  strcpy(tr_filename, argv[ii]);
+	  if (num_traces == SMT_MAX_THREADS) {
+	      die_message("Too many trace files");
+	  }
+	  tr_filenames[num_traces++] = argv[ii];
 	}
     }
 
-    
+
+    if (PIPE_ENGINE && (!FE_DEPTH || !ID_DEPTH || !MEM_DEPTH || !ALU_LAT || !LD_LAT || !ST_LAT || !CBR_LAT)) {
+        die_message("Deep engine depths and latencies must be at least 1");
+    }
+
+    if (PIPE_ENGINE == 2 && (!ROB_SIZE || !IQ_SIZE || !LSQ_SIZE)) {
+        die_message("OoO engine queue sizes must be at least 1");
+    }
+
+    if (!num_traces) {
+        die_message("Must Provide a Trace File");
+    }
+
+    if (num_traces > 1 && PIPE_ENGINE != 2) {
+        die_message("Multiple trace files need the OoO engine (-engine 2)");
+    }
+
+    if (VALIDATE_SAMPLE && (PIPE_ENGINE != 1 || num_traces > 1 || EVENT_LOG_NAME)) {
+        die_message("Shadow validation runs the deep engine (-engine 1) on one trace, without -eventlog");
+    }
+
+    if (REF_HAZARD && (PIPE_ENGINE != 1 || FE_DEPTH != 1 || ID_DEPTH != 1 || MEM_DEPTH != 1 || ALU_LAT != 1 ||
+                       LD_LAT != 1 || ST_LAT != 1 || CBR_LAT != 1 || REDIRECT_EX)) {
+        die_message("-refhazard needs the deep engine (-engine 1) at the reference depths and latencies (all 1, no -redirectex)");
+    }
+
   // ------- Open Trace File -------------------------------------------
+  // In SMT mode every thread opens its own trace in smt_init
+    tr_file = NULL;
+    if (num_traces == 1) {
     sprintf(cmd_string,"gunzip -c %s", tr_filename);
     if ((tr_file = popen(cmd_string, "r")) == NULL){
         printf("Command string is %s\n", cmd_string);
@@ -109,19 +345,50 @@ int main(int argc, char *argv[])
     } else {
         printf("Opened file with command: %s \n", cmd_string);
     }
+    }
      
   // ------- Pipeline Initialization & Execution ----------------------
 
      pipeline = pipe_init(tr_file); 
+     if(num_traces > 1)
+       smt_init(pipeline, tr_filenames, num_traces);
+     if(PIPE_ENGINE == 1)
+       deep_init(pipeline);
+     else if(PIPE_ENGINE == 2)
+       ooo_init(pipeline);
+     if(TELEMETRY_NAME)
+       telemetry_open(TELEMETRY_NAME, argc, argv);
+     if(EVENT_LOG_NAME && !evlog_open(EVENT_LOG_NAME, PIPE_ENGINE, PIPE_WIDTH))
+       die_message("Unable to create the event log");
+     if(VALIDATE_SAMPLE)
+       validate_init(pipeline, tr_filename, VALIDATE_SAMPLE);
+
+     void (*cycle_fn)(Pipeline *) = pipe_cycle;
+     if(PIPE_ENGINE == 1)
+       cycle_fn = deep_cycle;
+     else if(PIPE_ENGINE == 2)
+       cycle_fn = ooo_cycle;
+     if(VALIDATE_SAMPLE)
+       cycle_fn = validate_cycle;
     
+    // Run a heartbeat interval at a time, so the heartbeat, deadlock
+    // check and telemetry stay out of the per-cycle loop
     while(!pipeline->halt) {
-      pipe_cycle(pipeline);
+      for(ii = 0; ii < HEARTBEAT_CYCLES && !pipeline->halt; ii++)
+        cycle_fn(pipeline);
       check_heartbeat();
     }
+    telemetry_publish(pipeline, TELEMETRY_DONE);
+    evlog_close();
+    if(VALIDATE_SAMPLE)
+      validate_finish(pipeline);
 
   // ------- Print Statistics------------------------------------------
     print_stats();
-    fclose(tr_file);
+    if(pipeline->smt)
+      smt_close(pipeline);
+    else
+      fclose(tr_file);
     return 0;
 }
 
@@ -142,11 +409,19 @@ void print_stats(void) {
     printf("\n%s_NUM_CYCLES         \t : %10u" , header, (uint32_t)stat_num_cycle);
     printf("\n%s_CPI                \t : %10.3f" , header, cpi);
 
-    if(BPRED_POLICY){
+    if(BPRED_POLICY && !pipeline->smt){
     printf("\n%s_BPRED_BRANCHES     \t : %10u" , header, (uint32_t)pipeline->b_pred->stat_num_branches)  ;
     printf("\n%s_BPRED_MISPRED      \t : %10u" , header, (uint32_t)pipeline->b_pred->stat_num_mispred)  ;
     printf("\n%s_MISPRED_RATE       \t : %10.3f" , header, 100.0*(double)(pipeline->b_pred->stat_num_mispred)/(double)(pipeline->b_pred->stat_num_branches));
     }
+
+    if(PIPE_ENGINE == 2){
+    ooo_print_stats(pipeline, header);
+    }
+
+    if(pipeline->smt){
+    smt_print_stats(pipeline, header);
+    }
     
     printf("\n\n");
 }
@@ -169,12 +444,14 @@ void check_heartbeat(void){
 
   // check for deadlock
   if(last_hbeat_inst == pipeline->stat_retired_inst){
+    telemetry_publish(pipeline, TELEMETRY_DEADLOCK);
     printf("No committed instructions in %u cycles.\n", HEARTBEAT_CYCLES);
     die_message("Pipeline is Deadlocked. Dying\n");
   }
 
   last_hbeat_cycle=pipeline->stat_num_cycle;
   last_hbeat_inst = pipeline->stat_retired_inst;
+  telemetry_publish(pipeline, TELEMETRY_RUNNING);
 
   // print a newline and CPI every so often
   if(pipeline->stat_num_cycle - last_hbeat_line >= 50*HEARTBEAT_CYCLES){
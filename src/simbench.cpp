@@ -0,0 +1,493 @@
+/********************************************************************
+ * File         : simbench.cpp
+ * Description  : Micro-benchmarks for the simulator's hot components
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <vector>
+
+#include "pipeline.h"
+
+void die_usage() {
+    printf("Usage : simbench [options]\n\n");
+    printf("Time the branch predictors, hazard checks, trace decode and latch moves in isolation\n");
+    printf("Options\n");
+    printf("   -iters       <num>    Calls per benchmark (Default: 2000000)\n");
+    printf("   -trace       <file>   Decode records from this trace instead of synthetic ones\n");
+    printf("   -only        <name>   Run only benchmarks whose name contains <name>\n");
+    exit(1);
+}
+
+void die_message(const char *msg) {
+    printf("Error! %s. Exiting...\n", msg);
+    exit(1);
+}
+
+/*********************************************************************
+ * Globals the pipeline and predictor modules read, set per benchmark
+ *********************************************************************/
+uint32_t  PIPE_WIDTH=1;
+uint32_t  ENABLE_MEM_FWD=0;
+uint32_t  ENABLE_EXE_FWD=0;
+uint32_t  BPRED_POLICY=0;
+
+static uint64_t ITERS = 2000000;
+static const char *ONLY = NULL;
+static volatile uint64_t sink;
+
+#define BENCH_SETS      256       // Distinct inputs cycled through, defeats trivial prediction
+#define BENCH_BRANCHES  65536     // Length of each generated branch stream
+#define BENCH_RECS      65536     // Records in the in-memory decode buffer
+
+static uint64_t xorshift(uint64_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+
+/*********************************************************************
+ * Hardware counters. A counter group around each timed loop; when
+ * perf_event_open is not permitted only wall time is reported.
+ *********************************************************************/
+
+#define HW_NUM  4
+static const char *hw_names[HW_NUM] = {"cycles", "instr", "br-miss", "L1D-miss"};
+static int hw_fd[HW_NUM] = {-1, -1, -1, -1};
+static bool hw_ok = false;
+
+static void hw_open(void)
+{
+    uint32_t types[HW_NUM] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+    uint64_t configs[HW_NUM] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+
+    for(int ii = 0; ii < HW_NUM; ii++){
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[ii];
+        attr.config = configs[ii];
+        attr.disabled = (ii == 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        hw_fd[ii] = syscall(__NR_perf_event_open, &attr, 0, -1, ii ? hw_fd[0] : -1, 0);
+        if(hw_fd[ii] < 0){
+            for(int jj = 0; jj < ii; jj++)
+                close(hw_fd[jj]);
+            printf("perf_event_open unavailable, reporting wall time only\n\n");
+            return;
+        }
+    }
+    hw_ok = true;
+}
+
+static void hw_start(void)
+{
+    if(!hw_ok)
+        return;
+    ioctl(hw_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(hw_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void hw_stop(uint64_t *counts)
+{
+    if(!hw_ok)
+        return;
+    ioctl(hw_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t buf[1 + HW_NUM];
+    if(read(hw_fd[0], buf, sizeof(buf)) == (ssize_t)sizeof(buf))
+        memcpy(counts, &buf[1], sizeof(uint64_t) * HW_NUM);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*********************************************************************
+ * Timing harness: run fn(arg, calls) once and print per-call figures,
+ * bench_note ends the line with any benchmark specific result
+ *********************************************************************/
+
+typedef void (*Bench_Fn)(void *arg, uint64_t calls);
+
+static bool bench_skip(const char *name)
+{
+    return ONLY && !strstr(name, ONLY);
+}
+
+static void bench_run(const char *name, Bench_Fn fn, void *arg)
+{
+    uint64_t counts[HW_NUM] = {0};
+
+    fn(arg, ITERS / 16 + 1);                // Warm caches and predictor tables
+    hw_start();
+    double t0 = now_ns();
+    fn(arg, ITERS);
+    double t1 = now_ns();
+    hw_stop(counts);
+
+    printf("%-34s %8.2f", name, (t1 - t0) / (double)ITERS);
+    for(int ii = 0; ii < HW_NUM; ii++){
+        if(hw_ok)
+            printf(" %9.2f", (double)counts[ii] / (double)ITERS);
+        else
+            printf(" %9s", "-");
+    }
+}
+
+static void bench_note(const char *note)
+{
+    printf("  %s\n", note);
+    fflush(stdout);
+}
+
+
+/*********************************************************************
+ * Branch predictors: GetPrediction followed by UpdatePredictor on a
+ * generated stream of 64 static branches
+ *********************************************************************/
+
+typedef struct Bench_Branch_Struct {
+    uint32_t pc;
+    bool dir;
+} Bench_Branch;
+
+typedef struct Bpred_Arg_Struct {
+    BPRED *bp;
+    const Bench_Branch *br;
+    uint64_t mispred;
+} Bpred_Arg;
+
+static void gen_branches(Bench_Branch *br, const char *pattern)
+{
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    uint32_t trip[64] = {0};
+
+    for(uint32_t ii = 0; ii < BENCH_BRANCHES; ii++){
+        uint32_t site = ii & 63;
+        br[ii].pc = 0x400000 + site * 12;
+        if(!strcmp(pattern, "taken"))
+            br[ii].dir = true;
+        else if(!strcmp(pattern, "alternate"))
+            br[ii].dir = (ii >> 6) & 1;
+        else if(!strcmp(pattern, "loop8"))
+            br[ii].dir = (++trip[site] & 7) != 0;
+        else if(!strcmp(pattern, "biased"))
+            br[ii].dir = xorshift(&seed) % 10 != 0;
+        else
+            br[ii].dir = xorshift(&seed) & 1;
+    }
+}
+
+static void bench_bpred_update(void *arg, uint64_t calls)
+{
+    Bpred_Arg *a = (Bpred_Arg *) arg;
+    a->mispred = 0;
+    for(uint64_t ii = 0; ii < calls; ii++){
+        const Bench_Branch *b = &a->br[ii & (BENCH_BRANCHES - 1)];
+        bool pred = a->bp->GetPrediction(b->pc);
+        a->bp->UpdatePredictor(b->pc, b->dir, pred);
+        a->mispred += (pred != b->dir);
+    }
+}
+
+static void bench_bpred_predict(void *arg, uint64_t calls)
+{
+    Bpred_Arg *a = (Bpred_Arg *) arg;
+    uint64_t taken = 0;
+    for(uint64_t ii = 0; ii < calls; ii++)
+        taken += a->bp->GetPrediction(a->br[ii & (BENCH_BRANCHES - 1)].pc);
+    sink = taken;
+}
+
+static void run_bpred(void)
+{
+    const char *policies[NUM_BPRED_TYPE] = {"perfect", "taken", "gshare", "perceptron", "tage"};
+    const char *patterns[5] = {"taken", "alternate", "loop8", "biased", "random"};
+    std::vector<Bench_Branch> br(BENCH_BRANCHES);
+
+    for(int pp = 0; pp < 5; pp++){
+        gen_branches(br.data(), patterns[pp]);
+        for(uint32_t policy = BPRED_ALWAYS_TAKEN; policy < NUM_BPRED_TYPE; policy++){
+            char name[64], extra[64];
+            Bpred_Arg a = { new BPRED(policy), br.data(), 0 };
+
+            snprintf(name, sizeof(name), "bpred.%s.%s", policies[policy], patterns[pp]);
+            if(!bench_skip(name)){
+                bench_run(name, bench_bpred_update, &a);
+                snprintf(extra, sizeof(extra), "mispred %.2f%%", 100.0 * (double)a.mispred / (double)ITERS);
+                bench_note(extra);
+            }
+            snprintf(name, sizeof(name), "bpred.%s.%s.predict", policies[policy], patterns[pp]);
+            if(!bench_skip(name)){
+                bench_run(name, bench_bpred_predict, &a);
+                bench_note("");
+            }
+            delete a.bp;
+        }
+    }
+}
+
+
+/*********************************************************************
+ * Hazard logic: one FE op against full EX/MEM latches, with sources
+ * drawn from a small register set so matches are common
+ *********************************************************************/
+
+typedef struct Hazard_Set_Struct {
+    Pipeline_Latch fe;
+    Pipeline_Latch ex[MAX_PIPE_WIDTH];
+    Pipeline_Latch mem[MAX_PIPE_WIDTH];
+} Hazard_Set;
+
+static void gen_latch(Pipeline_Latch *l, uint64_t *seed)
+{
+    uint64_t r = xorshift(seed);
+    memset(l, 0, sizeof(Pipeline_Latch));
+    l->valid = (r & 15) != 0;
+    l->op_id = r >> 40;
+    l->tr_entry.op_type = (r >> 4) % NUM_OP_TYPE;
+    l->tr_entry.dest = (r >> 8) & 15;
+    l->tr_entry.dest_needed = (r >> 12) & 1;
+    l->tr_entry.src1_reg = (r >> 16) & 15;
+    l->tr_entry.src1_needed = (r >> 20) & 1;
+    l->tr_entry.src2_reg = (r >> 24) & 15;
+    l->tr_entry.src2_needed = (r >> 28) & 1;
+    l->tr_entry.cc_read = ((r >> 32) & 7) == 0;
+    l->tr_entry.cc_write = ((r >> 35) & 7) == 0;
+}
+
+static void bench_dep_check(void *arg, uint64_t calls)
+{
+    Hazard_Set *sets = (Hazard_Set *) arg;
+    uint64_t stalls = 0;
+    for(uint64_t ii = 0; ii < calls; ii++){
+        Hazard_Set *s = &sets[ii & (BENCH_SETS - 1)];
+        s->fe.stall = false;
+        fe_dependence_check(&s->fe, s->ex, s->mem);
+        stalls += s->fe.stall;
+    }
+    sink = stalls;
+}
+
+static void bench_forwarding(void *arg, uint64_t calls)
+{
+    Hazard_Set *sets = (Hazard_Set *) arg;
+    uint64_t stalls = 0;
+    for(uint64_t ii = 0; ii < calls; ii++){
+        Hazard_Set *s = &sets[ii & (BENCH_SETS - 1)];
+        stalls += fe_data_forwarding(&s->fe, s->ex, s->mem);
+    }
+    sink = stalls;
+}
+
+static void run_hazard(void)
+{
+    std::vector<Hazard_Set> sets(BENCH_SETS);
+    uint64_t seed = 0x2545f4914f6cdd1dULL;
+
+    for(uint32_t ii = 0; ii < BENCH_SETS; ii++){
+        gen_latch(&sets[ii].fe, &seed);
+        sets[ii].fe.valid = true;
+        for(uint32_t jj = 0; jj < MAX_PIPE_WIDTH; jj++){
+            gen_latch(&sets[ii].ex[jj], &seed);
+            gen_latch(&sets[ii].mem[jj], &seed);
+        }
+    }
+
+    ENABLE_EXE_FWD = 1;
+    ENABLE_MEM_FWD = 1;
+    for(PIPE_WIDTH = 1; PIPE_WIDTH <= MAX_PIPE_WIDTH; PIPE_WIDTH *= 2){
+        char name[64];
+        snprintf(name, sizeof(name), "hazard.dep_check.w%u", PIPE_WIDTH);
+        if(!bench_skip(name)){
+            bench_run(name, bench_dep_check, sets.data());
+            bench_note("");
+        }
+        snprintf(name, sizeof(name), "hazard.forwarding.w%u", PIPE_WIDTH);
+        if(!bench_skip(name)){
+            bench_run(name, bench_forwarding, sets.data());
+            bench_note("");
+        }
+    }
+    ENABLE_EXE_FWD = 0;
+    ENABLE_MEM_FWD = 0;
+    PIPE_WIDTH = 1;
+}
+
+
+/*********************************************************************
+ * Trace decode: pipe_get_fetch_op from an in-memory stream, rewound
+ * when it runs dry so no gunzip pipe is on the timed path
+ *********************************************************************/
+
+typedef struct Decode_Arg_Struct {
+    Pipeline *p;
+    std::vector<Trace_Rec> recs;
+} Decode_Arg;
+
+static void bench_decode(void *arg, uint64_t calls)
+{
+    Decode_Arg *a = (Decode_Arg *) arg;
+    Pipeline_Latch op;
+    uint64_t valid = 0;
+    for(uint64_t ii = 0; ii < calls; ii++){
+        pipe_get_fetch_op(a->p, &op);
+        if(!op.valid){
+            rewind(a->p->tr_file);
+            continue;
+        }
+        valid++;
+    }
+    sink = valid;
+}
+
+static void run_decode(const char *trace)
+{
+    Decode_Arg a;
+    a.recs.resize(BENCH_RECS);
+    uint32_t num = BENCH_RECS;
+
+    if(trace){
+        char cmd_string[1100];
+        snprintf(cmd_string, sizeof(cmd_string), "gunzip -c %s", trace);
+        FILE *tr = popen(cmd_string, "r");
+        if(!tr)
+            die_message("Unable to open the trace file with gzip option");
+        num = fread(a.recs.data(), sizeof(Trace_Rec), BENCH_RECS, tr);
+        pclose(tr);
+        if(!num)
+            die_message("Trace file is empty");
+    }
+    else {
+        uint64_t seed = 0xd1b54a32d192ed03ULL;
+        for(uint32_t ii = 0; ii < num; ii++){
+            Pipeline_Latch l;
+            gen_latch(&l, &seed);
+            a.recs[ii] = l.tr_entry;
+            a.recs[ii].inst_addr = 0x400000 + ii * 4;
+        }
+    }
+
+    a.p = (Pipeline *) calloc (1, sizeof (Pipeline));
+    a.p->tr_file = fmemopen(a.recs.data(), (size_t)num * sizeof(Trace_Rec), "r");
+    a.p->halt_op_id = ((uint64_t)-1) - 3;
+    if(!bench_skip("decode.get_fetch_op")){
+        bench_run("decode.get_fetch_op", bench_decode, &a);
+        bench_note(trace ? trace : "synthetic records");
+    }
+    fclose(a.p->tr_file);
+    free(a.p);
+}
+
+
+/*********************************************************************
+ * Latch movement: the MEM/EX/ID copies of pipe_cycle with every lane
+ * holding a valid op
+ *********************************************************************/
+
+static void bench_cycle_MEM(void *arg, uint64_t calls)
+{
+    for(uint64_t ii = 0; ii < calls; ii++)
+        pipe_cycle_MEM((Pipeline *) arg);
+}
+
+static void bench_cycle_EX(void *arg, uint64_t calls)
+{
+    for(uint64_t ii = 0; ii < calls; ii++)
+        pipe_cycle_EX((Pipeline *) arg);
+}
+
+static void bench_cycle_ID(void *arg, uint64_t calls)
+{
+    for(uint64_t ii = 0; ii < calls; ii++)
+        pipe_cycle_ID((Pipeline *) arg);
+}
+
+static void run_latch(void)
+{
+    Pipeline *p = (Pipeline *) calloc (1, sizeof (Pipeline));
+    uint64_t seed = 0x5851f42d4c957f2dULL;
+
+    for(int ll = 0; ll < NUM_LATCH_TYPES; ll++)
+        for(int ii = 0; ii < MAX_PIPE_WIDTH; ii++){
+            gen_latch(&p->pipe_latch[ll][ii], &seed);
+            p->pipe_latch[ll][ii].valid = true;
+        }
+
+    for(PIPE_WIDTH = 1; PIPE_WIDTH <= MAX_PIPE_WIDTH; PIPE_WIDTH *= 2){
+        char name[64];
+        snprintf(name, sizeof(name), "latch.cycle_MEM.w%u", PIPE_WIDTH);
+        if(!bench_skip(name)){
+            bench_run(name, bench_cycle_MEM, p);
+            bench_note("");
+        }
+        snprintf(name, sizeof(name), "latch.cycle_EX.w%u", PIPE_WIDTH);
+        if(!bench_skip(name)){
+            bench_run(name, bench_cycle_EX, p);
+            bench_note("");
+        }
+        snprintf(name, sizeof(name), "latch.cycle_ID.w%u", PIPE_WIDTH);
+        if(!bench_skip(name)){
+            bench_run(name, bench_cycle_ID, p);
+            bench_note("");
+        }
+    }
+    PIPE_WIDTH = 1;
+    free(p);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *trace = NULL;
+    int ii;
+
+    for (ii = 1; ii < argc; ii++) {
+        if (!strcmp(argv[ii], "-h") || !strcmp(argv[ii], "-help")) {
+            die_usage();
+        }
+        else if (!strcmp(argv[ii], "-iters") && ii < argc - 1) {
+            ITERS = strtoull(argv[++ii], NULL, 10);
+        }
+        else if (!strcmp(argv[ii], "-trace") && ii < argc - 1) {
+            trace = argv[++ii];
+        }
+        else if (!strcmp(argv[ii], "-only") && ii < argc - 1) {
+            ONLY = argv[++ii];
+        }
+        else {
+            die_usage();
+        }
+    }
+    if (!ITERS) {
+        die_usage();
+    }
+
+    hw_open();
+    printf("%-34s %8s", "benchmark (per call)", "ns");
+    for(ii = 0; ii < HW_NUM; ii++)
+        printf(" %9s", hw_names[ii]);
+    printf("\n");
+
+    run_bpred();
+    run_hazard();
+    run_decode(trace);
+    run_latch();
+    return 0;
+}
@@ -0,0 +1,102 @@
+/********************************************************************
+ * File         : simwatch.cpp
+ * Description  : Poll the telemetry region of a running simulator
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "telemetry.h"
+
+void die_usage() {
+    printf("Usage : simwatch [options] <name>\n\n");
+    printf("Print the live counters of a simulator started with -telemetry <name>\n");
+    printf("Options\n");
+    printf("   -interval    <ms>     Poll period in milliseconds (Default: 1000)\n");
+    printf("   -once                 Print one sample and exit\n");
+    exit(1);
+}
+
+/*********************************************************************
+ * Copy a consistent snapshot, retrying while the simulator publishes
+ *********************************************************************/
+
+static void snapshot(const Telemetry *shm, Telemetry *out)
+{
+    for(;;){
+        uint64_t seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+        if(seq & 1)
+            continue;
+        memcpy(out, (const void *)shm, sizeof(Telemetry));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == seq)
+            return;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = NULL;
+    uint32_t interval_ms = 1000;
+    bool once = false;
+    char shm_name[256];
+    int ii;
+
+    for (ii = 1; ii < argc; ii++) {
+        if (!strcmp(argv[ii], "-h") || !strcmp(argv[ii], "-help")) {
+            die_usage();
+        }
+        else if (!strcmp(argv[ii], "-interval") && ii < argc - 1) {
+            interval_ms = atoi(argv[++ii]);
+        }
+        else if (!strcmp(argv[ii], "-once")) {
+            once = true;
+        }
+        else {
+            name = argv[ii];
+        }
+    }
+    if (!name) {
+        die_usage();
+    }
+
+    snprintf(shm_name, sizeof(shm_name), "/%s", name);
+    int fd = shm_open(shm_name, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Error! No telemetry region %s. Exiting...\n", shm_name);
+        return 1;
+    }
+    const Telemetry *shm = (const Telemetry *) mmap(NULL, sizeof(Telemetry), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED || shm->magic != TELEMETRY_MAGIC || shm->version != TELEMETRY_VERSION) {
+        printf("Error! %s is not a simulator telemetry region. Exiting...\n", shm_name);
+        return 1;
+    }
+
+    Telemetry t;
+    snapshot(shm, &t);
+    printf("pid %u : %s\n", (uint32_t)t.pid, t.config);
+    printf("%8s %12s %12s %7s %9s %12s %12s %12s %10s %8s\n", "state", "inst", "cycles", "cpi",
+           "mispred%", "stall_dep", "stall_cbr", "stall_struct", "trace_MB", "MIPS");
+
+    const char *states[3] = {"running", "done", "deadlock"};
+    for(;;){
+        snapshot(shm, &t);
+        printf("%8s %12llu %12llu %7.3f %9.3f %12llu %12llu %12llu %10.1f %8.2f\n",
+               t.state < 3 ? states[t.state] : "?",
+               (unsigned long long)t.retired_inst, (unsigned long long)t.num_cycle,
+               t.retired_inst ? (double)t.num_cycle / (double)t.retired_inst : 0.0,
+               t.num_branches ? 100.0 * (double)t.num_mispred / (double)t.num_branches : 0.0,
+               (unsigned long long)t.stall_dep, (unsigned long long)t.stall_cbr,
+               (unsigned long long)t.stall_struct, (double)t.trace_bytes / 1e6, t.mips);
+        fflush(stdout);
+        if (once || t.state != TELEMETRY_RUNNING)
+            break;
+        usleep(interval_ms * 1000);
+    }
+    return 0;
+}
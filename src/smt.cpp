@@ -0,0 +1,242 @@
+/***********************************************************************
+ * File         : smt.cpp
+ * Description  : Multi-trace (SMT) front end and per-thread statistics
+ **********************************************************************/
+
+#include "smt.h"
+#include "deeppipe.h"
+#include <cstdlib>
+#include <string.h>
+
+extern uint32_t PIPE_WIDTH;
+extern uint32_t BPRED_POLICY;
+extern uint32_t SMT_FETCH_POLICY;
+extern uint32_t SMT_BPRED_POLICY;
+extern char    *SMT_ALONE_IPC;
+
+void die_message(const char *msg);
+
+/**********************************************************************
+ * Open one trace buffer per thread and hand out branch predictors
+ **********************************************************************/
+
+void smt_init(Pipeline *p, char **tr_filenames, uint32_t num_threads){
+  Smt_Pipe *s = (Smt_Pipe *) calloc (1, sizeof (Smt_Pipe));
+  uint32_t ii;
+
+  s->num_threads = num_threads;
+  for(ii = 0; ii < num_threads; ii++){
+    Smt_Thread *t = &s->thread[ii];
+    t->tbuf = tbuf_open(tr_filenames[ii]);
+    if(!t->tbuf){
+      printf("Trace file is %s\n", tr_filenames[ii]);
+      die_message("Unable to open the trace file with gzip option \n");
+    }
+    if(BPRED_POLICY){
+      if(ii == 0 || SMT_BPRED_POLICY == SMT_BPRED_SHARED)
+        t->b_pred = p->b_pred;
+      else
+        t->b_pred = new BPRED(BPRED_POLICY);
+    }
+  }
+
+  // Optional comma separated single-thread IPCs, exactly one per trace
+  if(SMT_ALONE_IPC){
+    char *str = SMT_ALONE_IPC;
+    for(ii = 0; ii < num_threads && *str; ii++){
+      s->alone_ipc[ii] = strtod(str, &str);
+      if(!(s->alone_ipc[ii] > 0))
+        break;
+      if(*str == ',')
+        str++;
+    }
+    if(ii < num_threads || *str)
+      die_message("-smtalone needs one positive IPC per trace");
+  }
+
+  printf("** SMT %u THREADS FETCH:%s BPRED:%s **\n\n", num_threads,
+         SMT_FETCH_POLICY == SMT_FETCH_ICOUNT ? "ICOUNT" : "RR",
+         SMT_BPRED_POLICY == SMT_BPRED_PARTITIONED ? "PARTITIONED" : "SHARED");
+
+  p->smt = s;
+}
+
+void smt_close(Pipeline *p){
+  for(uint32_t ii = 0; ii < p->smt->num_threads; ii++)
+    tbuf_close(p->smt->thread[ii].tbuf);
+}
+
+
+/**********************************************************************
+ * Fetch: pick a thread, then fetch up to PIPE_WIDTH of its ops into
+ * the shared front-end queue
+ **********************************************************************/
+
+static void smt_check_bpred(Smt_Thread *t, Pipeline_Latch *fetch_op){
+  uint64_t PC = fetch_op->tr_entry.inst_addr;
+  bool taken = t->b_pred->GetPrediction(PC);
+  bool dir = fetch_op->tr_entry.br_dir;
+
+  t->b_pred->UpdatePredictor(PC, dir, taken);
+  t->stat_num_branches++;
+  if(taken != dir){
+    t->fetch_cbr_stall = true;
+    ++(t->b_pred->stat_num_mispred);
+    t->stat_num_mispred++;
+    fetch_op->is_mispred_cbr = true;
+  }
+}
+
+void smt_cycle_FE(Pipeline *p){
+  Smt_Pipe *s = p->smt;
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  int32_t pick = -1;
+  bool cbr_stall = false;
+  uint32_t ii;
+
+  for(ii = 0; ii < s->num_threads; ii++){
+    uint32_t tid = (s->rr_next + ii) % s->num_threads;
+    Smt_Thread *t = &s->thread[tid];
+    if(t->trace_done)
+      continue;
+    if(t->fetch_cbr_stall){
+      if(now < t->fetch_resume_cycle){
+        cbr_stall = true;
+        continue;
+      }
+      t->fetch_cbr_stall = false;
+    }
+    if(SMT_FETCH_POLICY == SMT_FETCH_RR){
+      pick = tid;
+      break;
+    }
+    if(pick < 0 || t->icount < s->thread[pick].icount)
+      pick = tid;
+  }
+  if(pick < 0){
+    if(cbr_stall)
+      p->stat_stall_cbr++;
+    return;
+  }
+  s->rr_next = (pick + 1) % s->num_threads;
+
+  Smt_Thread *t = &s->thread[pick];
+  for(ii = 0; ii < PIPE_WIDTH && d->fq_count < d->fq_cap; ii++){
+    Deep_Op *f = &d->fq[(d->fq_head + d->fq_count) & d->fq_mask];
+
+    if(!tbuf_next(t->tbuf, &f->op.tr_entry)){
+      t->trace_done = true;
+      break;
+    }
+    f->op.valid = true;
+    f->op.stall = false;
+    f->op.is_mispred_cbr = false;
+    f->op.op_id = ++t->op_id_tracker;
+    f->tid = pick;
+    f->ev_flags = 0;
+    f->fetch_cycle = now;
+    d->fq_count++;
+    t->icount++;
+
+    if(BPRED_POLICY && f->op.tr_entry.op_type == OP_CBR)
+      smt_check_bpred(t, &f->op);
+    if(t->fetch_cbr_stall){
+      t->fetch_resume_cycle = (uint64_t)-1;
+      break;
+    }
+  }
+}
+
+//--------------------------------------------------------------------//
+
+void smt_retire(Pipeline *p, uint32_t tid){
+  p->smt->thread[tid].stat_retired_inst++;
+}
+
+void smt_resolve_mispred(Pipeline *p, uint32_t tid){
+  p->smt->thread[tid].fetch_resume_cycle = p->stat_num_cycle;
+}
+
+void smt_check_done(Pipeline *p){
+  Smt_Pipe *s = p->smt;
+  for(uint32_t ii = 0; ii < s->num_threads; ii++){
+    Smt_Thread *t = &s->thread[ii];
+    if(!t->done && t->trace_done && t->stat_retired_inst == t->op_id_tracker){
+      t->done = true;
+      t->stat_done_cycle = p->stat_num_cycle;
+      s->num_done++;
+    }
+  }
+  if(s->num_done == s->num_threads)
+    p->halt = true;
+}
+
+
+/**********************************************************************
+ * Per-thread IPC and fairness. Throughput is total retired over the
+ * machine's cycles. With -smtalone the single-thread IPCs give weighted
+ * speedup, ANTT and slowdown-based fairness; without it fairness is
+ * the min/max ratio of the raw IPCs.
+ **********************************************************************/
+
+void smt_print_stats(Pipeline *p, const char *header){
+  Smt_Pipe *s = p->smt;
+  uint64_t branches = 0, mispred = 0, retired = 0;
+  double sum_inv_ipc = 0;
+  double min_rel = 0, max_rel = 0;
+  double wspeedup = 0, antt = 0;
+  bool have_alone = SMT_ALONE_IPC != NULL;    // smt_init checked one per thread
+  bool idle = false;                          // Some thread retired nothing
+  uint32_t ii;
+
+  for(ii = 0; ii < s->num_threads; ii++){
+    Smt_Thread *t = &s->thread[ii];
+    double ipc = t->stat_done_cycle ? (double)t->stat_retired_inst / (double)t->stat_done_cycle : 0;
+    double rel = have_alone ? ipc / s->alone_ipc[ii] : ipc;
+
+    printf("\n%s_T%u_NUM_INST        \t : %10u" , header, ii, (uint32_t)t->stat_retired_inst);
+    printf("\n%s_T%u_NUM_CYCLES      \t : %10u" , header, ii, (uint32_t)t->stat_done_cycle);
+    printf("\n%s_T%u_IPC             \t : %10.3f" , header, ii, ipc);
+    if(BPRED_POLICY){
+    printf("\n%s_T%u_MISPRED_RATE    \t : %10.3f" , header, ii,
+           t->stat_num_branches ? 100.0*(double)t->stat_num_mispred/(double)t->stat_num_branches : 0.0);
+    }
+    if(have_alone){
+    printf("\n%s_T%u_SPEEDUP         \t : %10.3f" , header, ii, rel);
+      wspeedup += rel;
+    }
+
+    branches += t->stat_num_branches;
+    mispred += t->stat_num_mispred;
+    retired += t->stat_retired_inst;
+    if(ipc > 0){
+      sum_inv_ipc += 1.0 / ipc;
+      antt += 1.0 / rel;
+    }
+    else
+      idle = true;
+    if(ii == 0 || rel < min_rel)
+      min_rel = rel;
+    if(ii == 0 || rel > max_rel)
+      max_rel = rel;
+  }
+
+  if(BPRED_POLICY){
+    printf("\n%s_BPRED_BRANCHES     \t : %10u" , header, (uint32_t)branches);
+    printf("\n%s_BPRED_MISPRED      \t : %10u" , header, (uint32_t)mispred);
+    printf("\n%s_MISPRED_RATE       \t : %10.3f" , header,
+           branches ? 100.0*(double)mispred/(double)branches : 0.0);
+  }
+  printf("\n%s_SMT_THROUGHPUT     \t : %10.3f" , header,
+         p->stat_num_cycle ? (double)retired / (double)p->stat_num_cycle : 0.0);
+  // A thread that never retires has IPC 0, so does the harmonic mean
+  printf("\n%s_SMT_HMEAN_IPC      \t : %10.3f" , header,
+         idle ? 0.0 : (double)s->num_threads / sum_inv_ipc);
+  if(have_alone){
+    printf("\n%s_SMT_WSPEEDUP       \t : %10.3f" , header, wspeedup);
+    if(!idle)
+    printf("\n%s_SMT_ANTT           \t : %10.3f" , header, antt / (double)s->num_threads);
+  }
+  printf("\n%s_SMT_FAIRNESS       \t : %10.3f" , header, max_rel > 0 ? min_rel / max_rel : 0.0);
+}
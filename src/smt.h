@@ -0,0 +1,68 @@
+#ifndef _SMT_H
+#define _SMT_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "pipeline.h"
+#include "tracebuf.h"
+
+#define SMT_MAX_THREADS 8
+
+typedef enum SMT_FETCH_ENUM {
+    SMT_FETCH_RR=0,               // Round robin over threads that can fetch
+    SMT_FETCH_ICOUNT=1,           // Thread with the fewest un-issued ops
+    NUM_SMT_FETCH=2
+} SMT_FETCH;
+
+typedef enum SMT_BPRED_ENUM {
+    SMT_BPRED_SHARED=0,           // All threads train one predictor
+    SMT_BPRED_PARTITIONED=1,      // One private predictor per thread
+    NUM_SMT_BPRED=2
+} SMT_BPRED;
+
+
+/*********************************************************************
+* Multi-trace (SMT) Mode
+*
+* Runs one trace per hardware thread on the OoO engine. Threads share
+* the fetch queue, ROB, IQ and LSQ; each has its own architectural
+* register namespace in the RAT, its own op ids, its own mispredict
+* fetch stall and optionally its own branch predictor. Each cycle the
+* fetch policy picks one thread to fetch up to PIPE_WIDTH ops from.
+**********************************************************************/
+
+typedef struct Smt_Thread_Struct {
+  Trace_Buf *tbuf;
+  BPRED    *b_pred;               // Shared p->b_pred or a private copy
+
+  uint64_t op_id_tracker;
+  bool     trace_done;            // Fetched the last op
+  bool     done;                  // Retired the last op
+  bool     fetch_cbr_stall;
+  uint64_t fetch_resume_cycle;
+  uint32_t icount;                // Fetched but not yet issued
+
+  uint64_t stat_retired_inst;
+  uint64_t stat_done_cycle;       // Cycle the last op retired
+  uint64_t stat_num_branches;
+  uint64_t stat_num_mispred;
+} Smt_Thread;
+
+typedef struct Smt_Pipe_Struct {
+  uint32_t    num_threads;
+  uint32_t    num_done;
+  uint32_t    rr_next;            // Round robin pointer
+  Smt_Thread  thread[SMT_MAX_THREADS];
+  double      alone_ipc[SMT_MAX_THREADS];  // Single-thread IPC for fairness (0: unknown)
+} Smt_Pipe;
+
+void smt_init(Pipeline *p, char **tr_filenames, uint32_t num_threads);
+void smt_cycle_FE(Pipeline *p);                     // Fetch for one Thread
+void smt_retire(Pipeline *p, uint32_t tid);         // Account one retired op
+void smt_resolve_mispred(Pipeline *p, uint32_t tid); // Let the thread fetch again
+void smt_check_done(Pipeline *p);                   // Halt once every thread finished
+void smt_print_stats(Pipeline *p, const char *header);
+void smt_close(Pipeline *p);
+
+#endif
@@ -0,0 +1,115 @@
+/***********************************************************************
+ * File         : telemetry.cpp
+ * Description  : Publish simulator counters into shared memory
+ **********************************************************************/
+
+#include "telemetry.h"
+#include "ooopipe.h"
+#include "smt.h"
+#include <cstdlib>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+extern uint32_t BPRED_POLICY;
+
+static Telemetry *tele = NULL;
+static char tele_name[256];
+static struct timeval tele_start;
+
+/**********************************************************************
+ * Create the region, it is removed again by telemetry_close (also
+ * registered with atexit so die_message cleans up)
+ **********************************************************************/
+
+void telemetry_open(const char *name, int argc, char **argv){
+  snprintf(tele_name, sizeof(tele_name), "/%s", name);
+
+  int fd = shm_open(tele_name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if(fd < 0 || ftruncate(fd, sizeof(Telemetry)) < 0){
+    printf("Unable to create telemetry region %s, continuing without it\n", tele_name);
+    if(fd >= 0)
+      close(fd);
+    return;
+  }
+  void *mem = mmap(NULL, sizeof(Telemetry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED){
+    printf("Unable to map telemetry region %s, continuing without it\n", tele_name);
+    shm_unlink(tele_name);
+    return;
+  }
+
+  tele = (Telemetry *) mem;
+  memset(tele, 0, sizeof(Telemetry));
+  tele->magic = TELEMETRY_MAGIC;
+  tele->version = TELEMETRY_VERSION;
+  tele->pid = getpid();
+  for(int ii = 0; ii < argc; ii++){
+    strncat(tele->config, argv[ii], sizeof(tele->config) - strlen(tele->config) - 1);
+    strncat(tele->config, " ", sizeof(tele->config) - strlen(tele->config) - 1);
+  }
+
+  gettimeofday(&tele_start, NULL);
+  atexit(telemetry_close);
+  printf("Telemetry published at /dev/shm%s\n", tele_name);
+}
+
+void telemetry_close(void){
+  if(!tele)
+    return;
+  munmap(tele, sizeof(Telemetry));
+  shm_unlink(tele_name);
+  tele = NULL;
+}
+
+/**********************************************************************
+ * Gather the counters and publish them under the sequence lock
+ **********************************************************************/
+
+void telemetry_publish(Pipeline *p, uint32_t state){
+  if(!tele)
+    return;
+
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  uint64_t wall_usec = (now.tv_sec - tele_start.tv_sec) * 1000000ULL + (now.tv_usec - tele_start.tv_usec);
+
+  uint64_t branches = 0, mispred = 0, trace_bytes = 0, stall_struct = 0;
+  if(p->smt){
+    for(uint32_t ii = 0; ii < p->smt->num_threads; ii++){
+      branches += p->smt->thread[ii].stat_num_branches;
+      mispred += p->smt->thread[ii].stat_num_mispred;
+      trace_bytes += p->smt->thread[ii].tbuf->stat_bytes;
+    }
+  }
+  else {
+    if(BPRED_POLICY){
+      branches = p->b_pred->stat_num_branches;
+      mispred = p->b_pred->stat_num_mispred;
+    }
+    trace_bytes = p->op_id_tracker * sizeof(Trace_Rec);
+  }
+  if(p->ooo)
+    stall_struct = p->ooo->stat_full_rob + p->ooo->stat_full_iq + p->ooo->stat_full_lsq;
+
+  uint64_t seq = tele->seq;
+  __atomic_store_n(&tele->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  tele->state        = state;
+  tele->retired_inst = p->stat_retired_inst;
+  tele->num_cycle    = p->stat_num_cycle;
+  tele->num_branches = branches;
+  tele->num_mispred  = mispred;
+  tele->stall_dep    = p->stat_stall_dep;
+  tele->stall_cbr    = p->stat_stall_cbr;
+  tele->stall_struct = stall_struct;
+  tele->trace_bytes  = trace_bytes;
+  tele->wall_usec    = wall_usec;
+  tele->mips         = wall_usec ? (double)p->stat_retired_inst / (double)wall_usec : 0;
+
+  __atomic_store_n(&tele->seq, seq + 2, __ATOMIC_RELEASE);
+}
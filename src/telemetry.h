@@ -0,0 +1,54 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include <inttypes.h>
+
+#include "pipeline.h"
+
+#define TELEMETRY_MAGIC    0x53494d54   // "SIMT"
+#define TELEMETRY_VERSION  1
+
+typedef enum Telemetry_State_ENUM {
+    TELEMETRY_RUNNING=0,
+    TELEMETRY_DONE=1,
+    TELEMETRY_DEADLOCK=2
+} Telemetry_State;
+
+
+/*********************************************************************
+* Live Telemetry
+*
+* With -telemetry <name> the simulator maps a POSIX shared memory
+* region /dev/shm/<name> and republishes its counters there once per
+* heartbeat interval. The hot loop never touches the region. Updates
+* use a sequence lock: seq is odd while a publish is in progress, so
+* a reader (simwatch) copies the record and retries if seq changed.
+**********************************************************************/
+
+typedef struct Telemetry_Struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t seq;                   // Sequence lock, odd while writing
+  uint64_t pid;                   // Simulator process, for the scheduler
+  uint32_t state;                 // Telemetry_State
+  uint32_t pad;
+
+  uint64_t retired_inst;
+  uint64_t num_cycle;
+  uint64_t num_branches;
+  uint64_t num_mispred;
+  uint64_t stall_dep;             // Cycles issue waited on a data hazard
+  uint64_t stall_cbr;             // Cycles fetch waited on a mispredict
+  uint64_t stall_struct;          // Cycles rename waited on a full ROB/IQ/LSQ
+  uint64_t trace_bytes;           // Trace bytes consumed
+  uint64_t wall_usec;             // Time since start
+  double   mips;                  // Retired instructions per wall-clock microsecond
+
+  char     config[256];           // Command line
+} Telemetry;
+
+void telemetry_open(const char *name, int argc, char **argv);
+void telemetry_publish(Pipeline *p, uint32_t state);
+void telemetry_close(void);
+
+#endif
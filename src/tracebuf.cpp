@@ -0,0 +1,103 @@
+/***********************************************************************
+ * File         : tracebuf.cpp
+ * Description  : Trace reader with a background decoder thread
+ **********************************************************************/
+
+#include "tracebuf.h"
+#include <cstdlib>
+
+/**********************************************************************
+ * Decoder thread: fill free chunks until the trace runs out
+ **********************************************************************/
+
+static void tbuf_decode(Trace_Buf *tb)
+{
+  for(;;){
+    Trace_Chunk *c = &tb->chunk[tb->prod_idx];
+    {
+      std::unique_lock<std::mutex> guard(tb->lock);
+      tb->cv.wait(guard, [&]{ return !c->full || tb->stop; });
+      if(tb->stop)
+        return;
+    }
+
+    c->count = fread(c->rec, sizeof(Trace_Rec), TBUF_CHUNK_RECS, tb->tr_file);
+
+    {
+      std::lock_guard<std::mutex> guard(tb->lock);
+      c->full = true;
+    }
+    tb->cv.notify_all();
+
+    if(c->count < TBUF_CHUNK_RECS)
+      return;
+    tb->prod_idx = (tb->prod_idx + 1) % TBUF_NUM_CHUNKS;
+  }
+}
+
+/**********************************************************************
+ * Simulator side
+ **********************************************************************/
+
+Trace_Buf* tbuf_open(const char *tr_filename)
+{
+  char cmd_string[1100];
+  Trace_Buf *tb = new Trace_Buf();
+
+  sprintf(cmd_string, "gunzip -c %s", tr_filename);
+  if ((tb->tr_file = popen(cmd_string, "r")) == NULL){
+    delete tb;
+    return NULL;
+  }
+  printf("Opened file with command: %s \n", cmd_string);
+
+  tb->decoder = std::thread(tbuf_decode, tb);
+  return tb;
+}
+
+bool tbuf_next(Trace_Buf *tb, Trace_Rec *rec)
+{
+  if(tb->eof)
+    return false;
+
+  if(!tb->cons_holding){
+    Trace_Chunk *c = &tb->chunk[tb->cons_idx];
+    std::unique_lock<std::mutex> guard(tb->lock);
+    tb->cv.wait(guard, [&]{ return c->full; });
+    tb->cons_holding = true;
+    tb->cons_pos = 0;
+  }
+
+  Trace_Chunk *c = &tb->chunk[tb->cons_idx];
+  if(tb->cons_pos == c->count){
+    // A short chunk is the last one
+    if(c->count < TBUF_CHUNK_RECS){
+      tb->eof = true;
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> guard(tb->lock);
+      c->full = false;
+      tb->cons_holding = false;
+    }
+    tb->cv.notify_all();
+    tb->cons_idx = (tb->cons_idx + 1) % TBUF_NUM_CHUNKS;
+    return tbuf_next(tb, rec);
+  }
+
+  *rec = c->rec[tb->cons_pos++];
+  tb->stat_bytes += sizeof(Trace_Rec);
+  return true;
+}
+
+void tbuf_close(Trace_Buf *tb)
+{
+  {
+    std::lock_guard<std::mutex> guard(tb->lock);
+    tb->stop = true;
+  }
+  tb->cv.notify_all();
+  tb->decoder.join();
+  pclose(tb->tr_file);
+  delete tb;
+}
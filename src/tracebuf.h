@@ -0,0 +1,52 @@
+#ifndef _TRACEBUF_H
+#define _TRACEBUF_H
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "trace.h"
+
+#define TBUF_NUM_CHUNKS  4        // Chunks in flight between decoder and simulator
+#define TBUF_CHUNK_RECS  4096     // Trace records per chunk
+
+
+/*********************************************************************
+* Buffered Trace Reader
+*
+* A decoder thread per trace reads records from the gunzip pipe into a
+* small ring of chunks, so several traces are decompressed and read in
+* parallel. The simulator only synchronizes when it moves to the next
+* chunk; tbuf_next is a plain copy otherwise.
+**********************************************************************/
+
+typedef struct Trace_Chunk_Struct {
+  Trace_Rec rec[TBUF_CHUNK_RECS];
+  uint32_t count;                 // Valid records, < TBUF_CHUNK_RECS marks the end of trace
+  bool full;                      // Owned by the consumer when set
+} Trace_Chunk;
+
+typedef struct Trace_Buf_Struct {
+  FILE *tr_file;
+  Trace_Chunk chunk[TBUF_NUM_CHUNKS];
+  uint32_t prod_idx;              // Next chunk the decoder fills
+  uint32_t cons_idx;              // Chunk the simulator reads from
+  uint32_t cons_pos;              // Next record in chunk[cons_idx]
+  bool cons_holding;              // Simulator owns chunk[cons_idx]
+  bool eof;                       // Simulator has seen the end of trace
+  bool stop;                      // Ask the decoder to exit early
+
+  uint64_t stat_bytes;            // Trace bytes handed to the simulator
+
+  std::thread decoder;
+  std::mutex lock;
+  std::condition_variable cv;
+} Trace_Buf;
+
+Trace_Buf* tbuf_open(const char *tr_filename);    // Open trace & start decoder
+bool tbuf_next(Trace_Buf *tb, Trace_Rec *rec);    // Next record, false at end
+void tbuf_close(Trace_Buf *tb);                   // Stop decoder & close trace
+
+#endif
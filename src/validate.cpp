@@ -0,0 +1,290 @@
+/***********************************************************************
+ * File         : validate.cpp
+ * Description  : Lockstep shadow validation against the reference model
+ **********************************************************************/
+
+#include "validate.h"
+#include "deeppipe.h"
+#include <cstdlib>
+#include <string.h>
+
+extern uint32_t PIPE_WIDTH;
+extern uint32_t BPRED_POLICY;
+extern uint32_t FE_DEPTH;
+extern uint32_t ID_DEPTH;
+extern uint32_t MEM_DEPTH;
+extern uint32_t ALU_LAT;
+extern uint32_t LD_LAT;
+extern uint32_t ST_LAT;
+extern uint32_t CBR_LAT;
+extern uint32_t REDIRECT_EX;
+extern uint32_t REF_HAZARD;
+
+void die_message(const char *msg);
+
+static Pipeline *ref = NULL;          // Shadow reference pipeline
+static FILE *ref_tr_file = NULL;
+static uint32_t sample = 1;           // Check one interval in sample
+static uint64_t stat_checked = 0;     // Cycles compared
+static bool check = true;             // Current interval is sampled
+static uint64_t next_interval = 0;    // First cycle of the next interval
+static uint64_t stat_intervals = 0;   // Intervals checked
+static bool lockstep = true;          // Same depths as the reference, timing compared
+
+/* Op ids held in one stage, oldest first */
+typedef struct Validate_Stage_Struct {
+  uint32_t count;
+  uint64_t op_id[VALIDATE_MAX_OPS];
+} Validate_Stage;
+
+/**********************************************************************
+ * Open the shadow copy of the trace, the reference pipeline gets its
+ * own branch predictor so both see identical predictor state. The
+ * deep engine is checked as configured: cycle by cycle at the
+ * reference's depths, by its retired ops otherwise.
+ **********************************************************************/
+
+void validate_init(Pipeline *p, const char *tr_filename, uint32_t sample_in){
+  char cmd_string[1100];
+
+  if(!p->deep)
+    die_message("Shadow validation needs the deep engine (-engine 1)");
+
+  sprintf(cmd_string, "gunzip -c %s", tr_filename);
+  if((ref_tr_file = popen(cmd_string, "r")) == NULL)
+    die_message("Unable to open the shadow trace with gzip option \n");
+
+  ref = pipe_init(ref_tr_file);
+  sample = sample_in;
+  lockstep = FE_DEPTH == 1 && ID_DEPTH == 1 && MEM_DEPTH == 1 && ALU_LAT == 1 &&
+             LD_LAT == 1 && ST_LAT == 1 && CBR_LAT == 1 && !REDIRECT_EX;
+  if(lockstep)
+    printf("** SHADOW VALIDATION vs REFERENCE, %s, HAZARDS:%s **\n\n",
+           sample == 1 ? "EVERY CYCLE" : "SAMPLED",
+           REF_HAZARD ? "REFERENCE (-refhazard, SCOREBOARD NOT CHECKED)" : "SCOREBOARD");
+  else
+    printf("** SHADOW VALIDATION vs REFERENCE, RETIRED OPS ONLY (DEPTHS DIFFER, TIMING NOT COMPARED) **\n\n");
+}
+
+//--------------------------------------------------------------------//
+
+static void validate_ref_stage(Validate_Stage *st, Latch_Type lt){
+  Pipeline_Latch *latch = ref->pipe_latch[lt];
+  st->count = 0;
+  for(uint32_t ii = 0; ii < PIPE_WIDTH; ii++)
+    if(latch[ii].valid)
+      st->op_id[st->count++] = latch[ii].op_id;
+
+  // Lanes need not be in age order, the deep engine's queues are
+  for(uint32_t ii = 1; ii < st->count; ii++)
+    for(uint32_t jj = ii; jj > 0 && st->op_id[jj-1] > st->op_id[jj]; jj--){
+      uint64_t t = st->op_id[jj];
+      st->op_id[jj] = st->op_id[jj-1];
+      st->op_id[jj-1] = t;
+    }
+}
+
+static void validate_deep_stages(Pipeline *p, Validate_Stage *st){
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t ii;
+
+  for(ii = 0; ii <= NUM_LATCH_TYPES; ii++)
+    st[ii].count = 0;
+
+  for(ii = 0; ii < d->fq_count; ii++){
+    Validate_Stage *s = &st[FE_LATCH];
+    if(s->count < VALIDATE_MAX_OPS)
+      s->op_id[s->count++] = d->fq[(d->fq_head + ii) & d->fq_mask].op.op_id;
+  }
+  for(ii = 0; ii < d->inflight_count; ii++){
+    Deep_Op *e = &d->inflight[(d->inflight_head + ii) & d->inflight_mask];
+    Validate_Stage *s = &st[deep_op_stage(e, now)];
+    if(s->count < VALIDATE_MAX_OPS)
+      s->op_id[s->count++] = e->op.op_id;
+  }
+}
+
+static void validate_fail(Pipeline *p, const char *what){
+  printf("\n\nShadow validation diverged at cycle %llu: %s\n",
+         (unsigned long long)p->stat_num_cycle, what);
+  printf("\nReference (pipe_cycle):\n");
+  pipe_print_state(ref);
+  printf("Deep engine:\n");
+  deep_print_state(p);
+  die_message("Shadow validation failed");
+}
+
+static void validate_retire(Pipeline *p){
+  if(p->stat_retired_inst != ref->stat_retired_inst)
+    validate_fail(p, "retired instruction count differs");
+  if(p->stat_retire_sig != ref->stat_retire_sig)
+    validate_fail(p, "retired op sequence differs");
+  if(p->halt != ref->halt)
+    validate_fail(p, "one engine halted before the other");
+}
+
+static void validate_state(Pipeline *p){
+  const char *names[NUM_LATCH_TYPES] = {"FE", "ID", "EX", "MEM"};
+  Validate_Stage want, got[NUM_LATCH_TYPES + 1];
+  char what[128];
+
+  validate_retire(p);
+  validate_deep_stages(p, got);
+  for(uint32_t lt = FE_LATCH; lt < NUM_LATCH_TYPES; lt++){
+    validate_ref_stage(&want, (Latch_Type)lt);
+    if(want.count != got[lt].count ||
+       memcmp(want.op_id, got[lt].op_id, want.count * sizeof(uint64_t))){
+      snprintf(what, sizeof(what), "%s latch holds different ops", names[lt]);
+      validate_fail(p, what);
+    }
+  }
+  if(got[NUM_LATCH_TYPES].count)
+    validate_fail(p, "ops finished MEM but did not retire");
+  stat_checked++;
+}
+
+/**********************************************************************
+ * Reseed the reference from the deep engine before a sampled interval:
+ * latches from the op queues, predictor and counters by copy, and the
+ * shadow trace advanced to the same record
+ **********************************************************************/
+
+static void validate_sync(Pipeline *p){
+  Deep_Pipe *d = p->deep;
+  uint64_t now = p->stat_num_cycle;
+  uint32_t lane[NUM_LATCH_TYPES] = {0};
+  static Trace_Rec skip[4096];
+
+  memset(ref->pipe_latch, 0, sizeof(ref->pipe_latch));
+  for(uint32_t ii = 0; ii < d->fq_count; ii++){
+    Pipeline_Latch *l = &ref->pipe_latch[FE_LATCH][lane[FE_LATCH]++];
+    *l = d->fq[(d->fq_head + ii) & d->fq_mask].op;
+  }
+  // -refhazard: invalid lanes still hold the op they last had, pipe_cycle_FE checks it
+  for(uint32_t ii = 0; REF_HAZARD && ii < d->fe_stale_count && lane[FE_LATCH] < PIPE_WIDTH; ii++)
+    ref->pipe_latch[FE_LATCH][lane[FE_LATCH]++].tr_entry = d->fe_stale[ii];
+  for(uint32_t ii = 0; ii < d->inflight_count; ii++){
+    Deep_Op *e = &d->inflight[(d->inflight_head + ii) & d->inflight_mask];
+    uint32_t lt = deep_op_stage(e, now);
+    if(lt == NUM_LATCH_TYPES || lane[lt] == PIPE_WIDTH)
+      validate_fail(p, "deep engine state has no reference equivalent");
+    ref->pipe_latch[lt][lane[lt]++] = e->op;
+  }
+
+  while(ref->op_id_tracker < p->op_id_tracker){
+    uint64_t want = p->op_id_tracker - ref->op_id_tracker;
+    size_t got = fread(skip, sizeof(Trace_Rec), want < 4096 ? want : 4096, ref_tr_file);
+    if(!got)
+      break;
+    ref->op_id_tracker += got;
+  }
+  ref->op_id_tracker = p->op_id_tracker;
+  ref->halt_op_id = p->halt_op_id;
+  ref->halt = p->halt;
+  ref->fetch_cbr_stall = p->fetch_cbr_stall;
+  if(BPRED_POLICY)
+    *ref->b_pred = *p->b_pred;
+
+  ref->stat_retired_inst = p->stat_retired_inst;
+  ref->stat_num_cycle = p->stat_num_cycle;
+  ref->stat_stall_dep = p->stat_stall_dep;
+  ref->stat_stall_cbr = p->stat_stall_cbr;
+  ref->stat_retire_sig = p->stat_retire_sig;
+}
+
+/**********************************************************************
+ * Other depths: the reference runs at its own pace and the retired op
+ * streams are compared whenever both have retired the same count
+ **********************************************************************/
+
+static void validate_ops(Pipeline *p){
+  deep_cycle(p);
+  while(!ref->halt && ref->stat_retired_inst < p->stat_retired_inst)
+    pipe_cycle(ref);
+
+  if(ref->stat_retired_inst == p->stat_retired_inst){
+    if(p->stat_retire_sig != ref->stat_retire_sig)
+      validate_fail(p, "retired op sequence differs");
+    stat_checked++;
+  }
+  else if(ref->stat_retired_inst < p->stat_retired_inst)
+    validate_fail(p, "the reference halted with fewer ops retired");
+}
+
+/**********************************************************************
+ * Lockstep cycle: both models advance one cycle, then compare. The
+ * reference sits idle through the intervals that are not sampled.
+ **********************************************************************/
+
+void validate_cycle(Pipeline *p){
+  if(!lockstep){
+    validate_ops(p);
+    return;
+  }
+
+  if(p->stat_num_cycle == next_interval){
+    check = (next_interval / VALIDATE_INTERVAL) % sample == 0;
+    next_interval += VALIDATE_INTERVAL;
+    if(check){
+      if(ref->stat_num_cycle != p->stat_num_cycle)
+        validate_sync(p);
+      stat_intervals++;
+    }
+  }
+
+  deep_cycle(p);
+  if(!check)
+    return;
+  if(!ref->halt)
+    pipe_cycle(ref);
+  validate_state(p);
+}
+
+//--------------------------------------------------------------------//
+
+static void validate_finish_ops(Pipeline *p){
+  while(!ref->halt)
+    pipe_cycle(ref);
+
+  validate_retire(p);
+  if(BPRED_POLICY && p->b_pred->stat_num_mispred != ref->b_pred->stat_num_mispred)
+    validate_fail(p, "branch mispredict count differs");
+
+  printf("\nShadow validation passed: retired ops match at %llu points and at the end, mispredicts match\n",
+         (unsigned long long)stat_checked);
+  printf("Timing not compared: %llu cycles vs %llu on the reference\n",
+         (unsigned long long)p->stat_num_cycle, (unsigned long long)ref->stat_num_cycle);
+}
+
+void validate_finish(Pipeline *p){
+  const char *hazards = REF_HAZARD ? "\nHazard checks were the reference's (-refhazard), the scoreboard was not checked\n" : "";
+
+  if(!lockstep){
+    validate_finish_ops(p);
+    pclose(ref_tr_file);
+    return;
+  }
+
+  // The last interval was not sampled, nothing left to compare
+  if(ref->stat_num_cycle != p->stat_num_cycle){
+    printf("\nShadow validation passed: %llu cycles checked in %llu intervals\n%s",
+           (unsigned long long)stat_checked, (unsigned long long)stat_intervals, hazards);
+    pclose(ref_tr_file);
+    return;
+  }
+
+  validate_retire(p);
+  if(p->stat_num_cycle != ref->stat_num_cycle)
+    validate_fail(p, "total cycle count differs");
+  if(BPRED_POLICY && p->b_pred->stat_num_mispred != ref->b_pred->stat_num_mispred)
+    validate_fail(p, "branch mispredict count differs");
+  if(p->stat_stall_cbr != ref->stat_stall_cbr)
+    validate_fail(p, "mispredict stall cycles differ");
+  if(p->stat_stall_dep != ref->stat_stall_dep)
+    validate_fail(p, "dependence stall cycles differ");
+
+  printf("\nShadow validation passed: %llu cycles checked in %llu intervals, final stats match\n%s",
+         (unsigned long long)stat_checked, (unsigned long long)stat_intervals, hazards);
+  pclose(ref_tr_file);
+}
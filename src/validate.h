@@ -0,0 +1,38 @@
+#ifndef _VALIDATE_H
+#define _VALIDATE_H
+
+#include <inttypes.h>
+
+#include "pipeline.h"
+
+#define VALIDATE_INTERVAL  10000                  // Cycles per sampling interval
+#define VALIDATE_MAX_OPS   (4 * MAX_PIPE_WIDTH)   // Ops compared per stage
+
+
+/*********************************************************************
+* Shadow Validation
+*
+* With -validate <N> a reference pipeline (pipe_cycle) runs on its own
+* copy of the trace alongside the deep engine, which is checked as
+* configured. At the reference's depths and latencies the two run in
+* lockstep: every checked cycle compares the retired count, an
+* order-sensitive signature of the retired op ids and the op ids held
+* in each of FE/ID/EX/MEM. N=1 checks every cycle and finally compares
+* the stats. N>1 checks one VALIDATE_INTERVAL in N: the reference
+* idles through the others and is reseeded from the deep engine's
+* state (latches, predictor, trace position, counters) when the next
+* sampled interval starts. The first divergence prints both states and
+* stops the run; the hazard quirks listed in deeppipe.h show up here.
+* Adding -refhazard runs the deep engine with the reference's hazard
+* checks instead, so the scoreboard is not checked (the run says so).
+*
+* Other depths cannot match cycle for cycle, so the whole run compares
+* only what must not change: the retired op sequence, whenever both
+* have retired the same count, and the final mispredict count.
+**********************************************************************/
+
+void validate_init(Pipeline *p, const char *tr_filename, uint32_t sample);
+void validate_cycle(Pipeline *p);     // One lockstep cycle, replaces deep_cycle
+void validate_finish(Pipeline *p);    // Compare final stats & close the trace
+
+#endif